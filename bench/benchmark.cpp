@@ -0,0 +1,492 @@
+// Benchmark driver for the Sparse Matrix kernels (build with "make bench", see README.md).
+//
+// Every kernel is run on every matrix with warmup runs, then timed over repeated runs; the report has the
+// median and the 10th/90th percentiles of the run times, the GFLOP/s and the effective bandwidth (bytes of
+// the CSR/CSC arrays and of the vectors, whatever the storage, divided by the median time). Matrices are the
+// Matrix Market files given on the command line and synthetic ones with fixed seeds, so that runs on the
+// same machine are comparable over time.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ConcurrentAssembler.hpp"
+#include "MixedPrecisionMatrix.hpp"
+#include "SparseMatrix.hpp"
+#include "chrono.hpp"
+
+namespace {
+
+    using Value = double;
+    using Index = std::size_t;
+
+    // Matrix to benchmark, as (row, col, value) triplets
+    struct Problem {
+        std::string name;
+        std::string file;           // Matrix Market file, empty for the generated matrices
+        std::size_t rows = 0;
+        std::size_t cols = 0;
+        std::vector<std::size_t> row_index;
+        std::vector<std::size_t> col_index;
+        std::vector<Value> values;
+    };
+
+    struct Options {
+        std::vector<std::string> files;
+        std::vector<std::string> generators;
+        std::vector<std::string> kernels;
+        std::size_t warmup = 2;
+        std::size_t repeat = 10;
+        std::size_t threads = 1;
+        std::string format = "table";
+        std::string output;
+    };
+
+    // Result of one kernel on one matrix
+    struct Record {
+        std::string matrix;
+        std::size_t rows = 0;
+        std::size_t cols = 0;
+        std::size_t nnz = 0;
+        std::string kernel;
+        std::string order;
+        std::string state;
+        std::size_t threads = 1;
+        std::size_t runs = 0;
+        double median_us = 0;
+        double p10_us = 0;
+        double p90_us = 0;
+        double min_us = 0;
+        double mean_us = 0;
+        double gflops = 0;          // 0 for the kernels with no floating point work
+        double gbytes = 0;          // effective GB/s
+    };
+
+    // ------------------------------------------------------------------------------------------------
+    // Synthetic matrices (fixed seeds)
+
+    void add_entry(Problem& p, std::size_t i, std::size_t j, Value v) {
+        p.row_index.push_back(i);
+        p.col_index.push_back(j);
+        p.values.push_back(v);
+    }
+
+    // n x n band matrix with half bandwidth b
+    Problem banded(std::size_t n, std::size_t b) {
+        Problem p{"banded_" + std::to_string(n) + "_" + std::to_string(b), "", n, n, {}, {}, {}};
+        for (std::size_t i = 0; i < n; ++i)
+            for (std::size_t j = (i > b ? i - b : 0); j <= std::min(n - 1, i + b); ++j)
+                add_entry(p, i, j, i == j ? 2.0 * b + 1.0 : -1.0);
+        return p;
+    }
+
+    // 5-point Laplacian on an m x m grid
+    Problem laplace2d(std::size_t m) {
+        const std::size_t n = m * m;
+        Problem p{"laplace2d_" + std::to_string(m), "", n, n, {}, {}, {}};
+        for (std::size_t a = 0; a < m; ++a) {
+            for (std::size_t b = 0; b < m; ++b) {
+                const std::size_t i = a * m + b;
+                add_entry(p, i, i, 4.0);
+                if (a > 0) add_entry(p, i, i - m, -1.0);
+                if (a + 1 < m) add_entry(p, i, i + m, -1.0);
+                if (b > 0) add_entry(p, i, i - 1, -1.0);
+                if (b + 1 < m) add_entry(p, i, i + 1, -1.0);
+            }
+        }
+        return p;
+    }
+
+    // 7-point Laplacian on an m x m x m grid
+    Problem laplace3d(std::size_t m) {
+        const std::size_t n = m * m * m;
+        Problem p{"laplace3d_" + std::to_string(m), "", n, n, {}, {}, {}};
+        for (std::size_t a = 0; a < m; ++a) {
+            for (std::size_t b = 0; b < m; ++b) {
+                for (std::size_t c = 0; c < m; ++c) {
+                    const std::size_t i = (a * m + b) * m + c;
+                    add_entry(p, i, i, 6.0);
+                    if (a > 0) add_entry(p, i, i - m * m, -1.0);
+                    if (a + 1 < m) add_entry(p, i, i + m * m, -1.0);
+                    if (b > 0) add_entry(p, i, i - m, -1.0);
+                    if (b + 1 < m) add_entry(p, i, i + m, -1.0);
+                    if (c > 0) add_entry(p, i, i - 1, -1.0);
+                    if (c + 1 < m) add_entry(p, i, i + 1, -1.0);
+                }
+            }
+        }
+        return p;
+    }
+
+    // n x n random matrix with power-law row lengths (Zipf exponent 1, average about avg non-zeros per row)
+    // and uniformly random columns, as in graphs with a few hub vertices
+    Problem powerlaw(std::size_t n, std::size_t avg) {
+        Problem p{"powerlaw_" + std::to_string(n) + "_" + std::to_string(avg), "", n, n, {}, {}, {}};
+        std::mt19937_64 gen(12345);
+        double harmonic = 0;
+        for (std::size_t r = 1; r <= n; ++r)
+            harmonic += 1.0 / static_cast<double>(r);
+        std::vector<std::size_t> rank(n);
+        for (std::size_t i = 0; i < n; ++i)
+            rank[i] = i + 1;
+        std::shuffle(rank.begin(), rank.end(), gen);
+        std::uniform_int_distribution<std::size_t> column(0, n - 1);
+        std::uniform_real_distribution<Value> value(-1.0, 1.0);
+        for (std::size_t i = 0; i < n; ++i) {
+            const double expected = static_cast<double>(avg * n) / (harmonic * static_cast<double>(rank[i]));
+            const std::size_t length = std::max<std::size_t>(1, std::min<std::size_t>(n, static_cast<std::size_t>(expected)));
+            for (std::size_t k = 0; k < length; ++k)
+                add_entry(p, i, column(gen), value(gen));
+        }
+        return p;
+    }
+
+    // "kind:size[:param]", e.g. laplace2d:300, banded:100000:3, powerlaw:50000:8
+    Problem generate(const std::string& spec) {
+        std::vector<std::string> parts;
+        std::stringstream ss(spec);
+        for (std::string item; std::getline(ss, item, ':');)
+            parts.push_back(item);
+        if (parts.size() < 2)
+            throw std::invalid_argument("Invalid generator \"" + spec + "\" (expected kind:size[:param])");
+        const std::size_t size = std::stoul(parts[1]);
+        const std::size_t param = parts.size() > 2 ? std::stoul(parts[2]) : 0;
+        if (parts[0] == "banded")
+            return banded(size, param ? param : 2);
+        if (parts[0] == "laplace2d")
+            return laplace2d(size);
+        if (parts[0] == "laplace3d")
+            return laplace3d(size);
+        if (parts[0] == "powerlaw")
+            return powerlaw(size, param ? param : 8);
+        throw std::invalid_argument("Unknown generator \"" + parts[0] + "\" (banded, laplace2d, laplace3d, powerlaw)");
+    }
+
+    Problem from_file(const std::string& filename) {
+        algebra::mm::Triplets<Value> t = algebra::mm::read<Value>(filename);
+        std::string name = filename.substr(filename.find_last_of('/') + 1);
+        Problem p{name.substr(0, name.find_last_of('.')), filename, t.header.rows, t.header.cols,
+                  std::move(t.rows), std::move(t.cols), std::move(t.values)};
+        return p;
+    }
+
+    // ------------------------------------------------------------------------------------------------
+    // Timing
+
+    // Runs setup() then the timed kernel(), warmup + repeat times, and fills the statistics of the record
+    void measure(Record& r, const Options& opt, const std::function<void()>& setup, const std::function<void()>& kernel) {
+        std::vector<double> times;
+        Timings::Chrono chrono;
+        for (std::size_t run = 0; run < opt.warmup + opt.repeat; ++run) {
+            setup();
+            chrono.start();
+            kernel();
+            chrono.stop();
+            if (run >= opt.warmup)
+                times.push_back(chrono.wallTime());
+        }
+        std::sort(times.begin(), times.end());
+        auto percentile = [&](double q) {
+            const double pos = q * static_cast<double>(times.size() - 1);
+            const std::size_t lo = static_cast<std::size_t>(pos);
+            const std::size_t hi = std::min(lo + 1, times.size() - 1);
+            return times[lo] + (pos - static_cast<double>(lo)) * (times[hi] - times[lo]);
+        };
+        r.runs = times.size();
+        r.median_us = percentile(0.5);
+        r.p10_us = percentile(0.1);
+        r.p90_us = percentile(0.9);
+        r.min_us = times.front();
+        double sum = 0;
+        for (double t : times)
+            sum += t;
+        r.mean_us = sum / static_cast<double>(times.size());
+    }
+
+    bool selected(const Options& opt, const std::string& kernel) {
+        return opt.kernels.empty() || std::find(opt.kernels.begin(), opt.kernels.end(), kernel) != opt.kernels.end();
+    }
+
+    template <StorageOrder Order>
+    const char* order_name() {
+        return Order == StorageOrder::RowMajor ? "row" : "col";
+    }
+
+    // Kernels of one storage order
+    template <StorageOrder Order>
+    void run_kernels(const Problem& p, const Options& opt, std::vector<Record>& records) {
+        using Matrix = algebra::SparseMatrix<Value, Order, Index>;
+        const std::size_t nnz_in = p.values.size();
+        auto record = [&](const std::string& kernel, const std::string& state, std::size_t nnz) {
+            Record r;
+            r.matrix = p.name;
+            r.rows = p.rows;
+            r.cols = p.cols;
+            r.nnz = nnz;
+            r.kernel = kernel;
+            r.order = order_name<Order>();
+            r.state = state;
+            r.threads = opt.threads;
+            return r;
+        };
+
+        Matrix compressed;
+        compressed.compress_from_triplets(p.rows, p.cols, p.row_index, p.col_index, p.values);
+        compressed.set_num_threads(opt.threads);
+        const std::size_t nnz = compressed.get_nnz();
+        Matrix uncompressed = compressed;
+        uncompressed.uncompress();
+        uncompressed.set_num_threads(opt.threads);
+        Matrix work;
+
+        if (!p.file.empty() && selected(opt, "load")) {
+            Record r = record("load", "compressed", nnz);
+            measure(r, opt, [] {}, [&] { work = Matrix(p.file, true); });
+            records.push_back(r);
+        }
+        if (selected(opt, "assemble")) {
+            // add() into the triplet buffer, then compress()
+            Record r = record("assemble", "compressed", nnz);
+            measure(r, opt, [&] { work = Matrix(p.rows, p.cols); }, [&] {
+                work.reserve(nnz_in);
+                for (std::size_t k = 0; k < nnz_in; ++k)
+                    work.add(p.row_index[k], p.col_index[k], p.values[k]);
+                work.compress();
+            });
+            records.push_back(r);
+        }
+        if (selected(opt, "assemble_concurrent")) {
+            // One slot per thread of the pool, then the parallel merge (the assembler is kept, as in a time loop)
+            algebra::ConcurrentAssembler<Value, Order, Index> assembler(p.rows, p.cols, opt.threads);
+            Record r = record("assemble_concurrent", "compressed", nnz);
+            measure(r, opt, [] {}, [&] {
+                algebra::parallel::run(opt.threads, [&](std::size_t t) {
+                    auto& local = assembler.local(t);
+                    for (std::size_t k = nnz_in * t / opt.threads; k < nnz_in * (t + 1) / opt.threads; ++k)
+                        local.add(p.row_index[k], p.col_index[k], p.values[k]);
+                });
+                work = assembler.assemble(opt.threads);
+            });
+            records.push_back(r);
+        }
+        if (selected(opt, "assemble_map")) {
+            // Insertion through the non-const call operator into the map
+            Record r = record("assemble_map", "uncompressed", nnz);
+            measure(r, opt, [&] { work = Matrix(p.rows, p.cols); }, [&] {
+                for (std::size_t k = 0; k < nnz_in; ++k)
+                    work(p.row_index[k], p.col_index[k]) += p.values[k];
+            });
+            records.push_back(r);
+        }
+        if (selected(opt, "compress")) {
+            Record r = record("compress", "uncompressed", nnz);
+            measure(r, opt, [&] { work = uncompressed; }, [&] { work.compress(); });
+            records.push_back(r);
+        }
+        if (selected(opt, "uncompress")) {
+            Record r = record("uncompress", "compressed", nnz);
+            measure(r, opt, [&] { work = compressed; }, [&] { work.uncompress(); });
+            records.push_back(r);
+        }
+        if (selected(opt, "spmv")) {
+            std::vector<Value> x(p.cols), y(p.rows);
+            for (std::size_t j = 0; j < x.size(); ++j)
+                x[j] = 1.0 + static_cast<Value>(j % 7);
+            // Effective traffic: the compressed arrays, x read once, y written once
+            const std::size_t outer = (Order == StorageOrder::RowMajor) ? p.rows : p.cols;
+            const double bytes = static_cast<double>(nnz * (sizeof(Value) + sizeof(Index)) + (outer + 1) * sizeof(Index) +
+                                                     (p.rows + p.cols) * sizeof(Value));
+            for (const Matrix* m : {&compressed, &uncompressed}) {
+                Record r = record("spmv", m->is_compressed() ? "compressed" : "uncompressed", nnz);
+                measure(r, opt, [] {}, [&] { m->multiply_into(y, x); });
+                r.gflops = 2.0 * static_cast<double>(nnz) / (r.median_us * 1e3);
+                r.gbytes = bytes / (r.median_us * 1e3);
+                records.push_back(r);
+            }
+        }
+        if (Order == StorageOrder::RowMajor && selected(opt, "spmv_mixed")) {
+            // CSR with values in float and bfloat16 and 32-bit indexes, double vectors (once: the copy is CSR
+            // whatever the order of the source)
+            std::vector<Value> x(p.cols), y(p.rows);
+            for (std::size_t j = 0; j < x.size(); ++j)
+                x[j] = 1.0 + static_cast<Value>(j % 7);
+            auto run = [&](const auto& m, const char* state) {
+                Record r = record("spmv_mixed", state, nnz);
+                measure(r, opt, [] {}, [&] { m.multiply_into(y, x); });
+                r.gflops = 2.0 * static_cast<double>(nnz) / (r.median_us * 1e3);
+                r.gbytes = static_cast<double>(m.memory_bytes() + (p.rows + p.cols) * sizeof(Value)) / (r.median_us * 1e3);
+                records.push_back(r);
+            };
+            algebra::MixedPrecisionMatrix<float, Value> single(compressed);
+            single.set_num_threads(opt.threads);
+            run(single, "float");
+            algebra::MixedPrecisionMatrix<algebra::bfloat16, Value> brain(compressed);
+            brain.set_num_threads(opt.threads);
+            run(brain, "bfloat16");
+        }
+    }
+
+    // ------------------------------------------------------------------------------------------------
+    // Output
+
+    void write_table(std::ostream& out, const std::vector<Record>& records) {
+        out << std::left;
+        out.width(24); out << "matrix";
+        out.width(21); out << "kernel";
+        out.width(5); out << "ord";
+        out.width(14); out << "state";
+        out << std::right;
+        out.width(10); out << "nnz";
+        out.width(13); out << "median[us]";
+        out.width(13); out << "p10[us]";
+        out.width(13); out << "p90[us]";
+        out.width(9); out << "GFLOP/s";
+        out.width(8); out << "GB/s" << "\n";
+        for (const Record& r : records) {
+            out << std::left;
+            out.width(24); out << r.matrix;
+            out.width(21); out << r.kernel;
+            out.width(5); out << r.order;
+            out.width(14); out << r.state;
+            out << std::right << std::fixed;
+            out.precision(1);
+            out.width(10); out << r.nnz;
+            out.width(13); out << r.median_us;
+            out.width(13); out << r.p10_us;
+            out.width(13); out << r.p90_us;
+            out.precision(3);
+            out.width(9); out << r.gflops;
+            out.width(8); out << r.gbytes << "\n";
+            out.unsetf(std::ios::fixed);
+        }
+    }
+
+    void write_csv(std::ostream& out, const std::vector<Record>& records) {
+        out << "matrix,rows,cols,nnz,kernel,order,state,threads,runs,median_us,p10_us,p90_us,min_us,mean_us,gflops,gbytes_per_s\n";
+        out.precision(6);
+        for (const Record& r : records)
+            out << r.matrix << ',' << r.rows << ',' << r.cols << ',' << r.nnz << ',' << r.kernel << ',' << r.order << ',' << r.state << ','
+                << r.threads << ',' << r.runs << ',' << r.median_us << ',' << r.p10_us << ',' << r.p90_us << ',' << r.min_us << ','
+                << r.mean_us << ',' << r.gflops << ',' << r.gbytes << '\n';
+    }
+
+    void write_json(std::ostream& out, const std::vector<Record>& records, const Options& opt) {
+        out.precision(6);
+        out << "{\n  \"compiler\": \"" << __VERSION__ << "\",\n"
+            << "  \"hardware_threads\": " << algebra::parallel::hardware_threads() << ",\n"
+            << "  \"warmup\": " << opt.warmup << ",\n  \"repeat\": " << opt.repeat << ",\n  \"results\": [\n";
+        for (std::size_t k = 0; k < records.size(); ++k) {
+            const Record& r = records[k];
+            out << "    {\"matrix\": \"" << r.matrix << "\", \"rows\": " << r.rows << ", \"cols\": " << r.cols << ", \"nnz\": " << r.nnz
+                << ", \"kernel\": \"" << r.kernel << "\", \"order\": \"" << r.order << "\", \"state\": \"" << r.state
+                << "\", \"threads\": " << r.threads << ", \"runs\": " << r.runs << ", \"median_us\": " << r.median_us
+                << ", \"p10_us\": " << r.p10_us << ", \"p90_us\": " << r.p90_us << ", \"min_us\": " << r.min_us
+                << ", \"mean_us\": " << r.mean_us << ", \"gflops\": " << r.gflops << ", \"gbytes_per_s\": " << r.gbytes << "}"
+                << (k + 1 < records.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+
+    void usage(std::ostream& out) {
+        out << "Usage: benchmark [options] [file.mtx ...]\n"
+               "  --gen kind:size[:param]  synthetic matrix: banded:n[:half_bandwidth], laplace2d:m, laplace3d:m,\n"
+               "                           powerlaw:n[:avg_nnz_per_row] (repeatable; default set if none and no file)\n"
+               "  --kernels list           comma-separated subset of load,assemble,assemble_map,compress,uncompress,spmv,\n"
+               "                           spmv_mixed,assemble_concurrent\n"
+               "  --warmup n               untimed runs per kernel (default 2)\n"
+               "  --repeat n               timed runs per kernel (default 10)\n"
+               "  --threads n              threads of the matrix-vector product (default 1)\n"
+               "  --format table|csv|json  output format (default table)\n"
+               "  --output file            write the report to a file instead of the standard output\n";
+    }
+
+    Options parse(int argc, char** argv) {
+        Options opt;
+        for (int a = 1; a < argc; ++a) {
+            const std::string arg = argv[a];
+            auto value = [&]() -> std::string {
+                if (a + 1 >= argc)
+                    throw std::invalid_argument("Missing value for " + arg);
+                return argv[++a];
+            };
+            if (arg == "--gen")
+                opt.generators.push_back(value());
+            else if (arg == "--kernels") {
+                std::stringstream ss(value());
+                for (std::string k; std::getline(ss, k, ',');)
+                    opt.kernels.push_back(k);
+            } else if (arg == "--warmup")
+                opt.warmup = std::stoul(value());
+            else if (arg == "--repeat")
+                opt.repeat = std::max<std::size_t>(1, std::stoul(value()));
+            else if (arg == "--threads")
+                opt.threads = std::max<std::size_t>(1, std::stoul(value()));
+            else if (arg == "--format")
+                opt.format = value();
+            else if (arg == "--output")
+                opt.output = value();
+            else if (arg == "--help" || arg == "-h") {
+                usage(std::cout);
+                std::exit(0);
+            } else if (!arg.empty() && arg[0] == '-')
+                throw std::invalid_argument("Unknown option " + arg);
+            else
+                opt.files.push_back(arg);
+        }
+        if (opt.format != "table" && opt.format != "csv" && opt.format != "json")
+            throw std::invalid_argument("Unknown format " + opt.format);
+        if (opt.files.empty() && opt.generators.empty())
+            opt.generators = {"banded:50000:2", "laplace2d:200", "laplace3d:30", "powerlaw:50000:5"};
+        return opt;
+    }
+
+}   // namespace
+
+int main(int argc, char** argv) {
+    // Only errors of the library are reported while the kernels run
+    algebra::instrumentation::set_log_level(algebra::instrumentation::LogLevel::Error);
+    try {
+        const Options opt = parse(argc, argv);
+        std::ofstream file;
+        if (!opt.output.empty()) {
+            file.open(opt.output);
+            if (!file)
+                throw std::runtime_error("Cannot open " + opt.output);
+        }
+        std::ostream& out = opt.output.empty() ? std::cout : file;
+
+        std::vector<Record> records;
+        std::vector<std::string> sources = opt.files;
+        sources.insert(sources.end(), opt.generators.begin(), opt.generators.end());
+        for (std::size_t s = 0; s < sources.size(); ++s) {
+            const Problem p = (s < opt.files.size()) ? from_file(sources[s]) : generate(sources[s]);
+            std::cerr << "benchmark: " << p.name << " (" << p.rows << "x" << p.cols << ", " << p.values.size() << " entries)" << std::endl;
+            run_kernels<StorageOrder::RowMajor>(p, opt, records);
+            run_kernels<StorageOrder::ColumnMajor>(p, opt, records);
+        }
+
+        if (opt.format == "csv")
+            write_csv(out, records);
+        else if (opt.format == "json")
+            write_json(out, records, opt);
+        else
+            write_table(out, records);
+        // Library-side timers of all the repetitions (make bench INSTRUMENT=1)
+        if (algebra::instrumentation::enabled())
+            algebra::instrumentation::dump(std::cerr);
+    } catch (const std::exception& e) {
+        std::cerr << "benchmark: " << e.what() << std::endl;
+        usage(std::cerr);
+        return 1;
+    }
+    return 0;
+}
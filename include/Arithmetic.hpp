@@ -0,0 +1,359 @@
+#ifndef ARITHMETIC_HPP
+#define ARITHMETIC_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Parallel.hpp"
+#include "RowArrays.hpp"
+#include "SparseMatrix.hpp"
+
+namespace algebra // Algebra namespace
+{
+    // Arithmetic on the compressed vectors of a matrix, without going back to the map. All the functions
+    // need compressed matrices with no pending insertions (std::invalid_argument otherwise); threads = 0
+    // means the number of threads of the matrix (set_num_threads)
+    namespace detail {
+        template <typename T, StorageOrder Order, typename Index>
+        std::size_t check_compressed(const SparseMatrix<T, Order, Index>& A, std::size_t threads) {
+            if (!A.is_compressed() || A.pending_size() != 0)
+                throw std::invalid_argument("The matrix must be compressed, with no pending insertions");
+            return threads ? threads : A.get_num_threads();
+        }
+
+        template <typename T, StorageOrder OrderA, StorageOrder OrderB, typename Index>
+        void check_same_size(const SparseMatrix<T, OrderA, Index>& A, const SparseMatrix<T, OrderB, Index>& B) {
+            if (A.get_rows() != B.get_rows() || A.get_cols() != B.get_cols())
+                throw std::invalid_argument("Matrices of different sizes (" + std::to_string(A.get_rows()) + "x" + std::to_string(A.get_cols()) +
+                                            " and " + std::to_string(B.get_rows()) + "x" + std::to_string(B.get_cols()) + ")");
+        }
+
+        inline std::size_t outer_count(StorageOrder order, std::size_t rows, std::size_t cols) {
+            return order == StorageOrder::RowMajor ? rows : cols;
+        }
+
+        // Sums f(value) along the outer indexes (rows of a RowMajor matrix, columns of a ColumnMajor one)
+        template <typename R, typename T, StorageOrder Order, typename Index, typename F>
+        std::vector<R> outer_sums(const SparseMatrix<T, Order, Index>& A, std::size_t threads, F f) {
+            const std::size_t n = outer_count(Order, A.get_rows(), A.get_cols());
+            const Index* outer = A.outer_indexes();
+            const T* vals = A.values_data();
+            std::vector<R> sums(n, R(0));
+            const std::size_t parts = std::max<std::size_t>(1, std::min(threads, n));
+            const auto bounds = parallel::balanced_partition(outer, n, parts);
+            parallel::run(parts, [&](std::size_t t) {
+                for (std::size_t o = bounds[t]; o < bounds[t + 1]; ++o) {
+                    R s = 0;
+                    for (std::size_t k = outer[o]; k < outer[o + 1]; ++k)
+                        s += f(vals[k]);
+                    sums[o] = s;
+                }
+            });
+            return sums;
+        }
+
+        // Sums f(value) along the inner indexes: every thread scatters a block of outer indexes into a private
+        // buffer, then the buffers are added range by range in a fixed order
+        template <typename R, typename T, StorageOrder Order, typename Index, typename F>
+        std::vector<R> inner_sums(const SparseMatrix<T, Order, Index>& A, std::size_t threads, F f) {
+            const std::size_t n = outer_count(Order, A.get_rows(), A.get_cols());
+            const std::size_t m = outer_count(Order, A.get_cols(), A.get_rows());
+            const Index* outer = A.outer_indexes();
+            const Index* inner = A.inner_indexes();
+            const T* vals = A.values_data();
+            std::vector<R> sums(m, R(0));
+            const std::size_t parts = std::max<std::size_t>(1, std::min(threads, n));
+            if (parts == 1) {
+                for (std::size_t k = 0; k < A.get_nnz(); ++k)
+                    sums[inner[k]] += f(vals[k]);
+                return sums;
+            }
+            const auto bounds = parallel::balanced_partition(outer, n, parts);
+            std::vector<std::vector<R>> partial(parts);
+            parallel::run(parts, [&](std::size_t t) {
+                partial[t].assign(m, R(0));
+                for (std::size_t k = outer[bounds[t]]; k < outer[bounds[t + 1]]; ++k)
+                    partial[t][inner[k]] += f(vals[k]);
+            });
+            parallel::for_range(m, parts, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t t = 0; t < parts; ++t)
+                    for (std::size_t j = begin; j < end; ++j)
+                        sums[j] += partial[t][j];
+            });
+            return sums;
+        }
+
+        // Position of inner index j in the sorted segment [first, last) of the inner indexes, or last
+        template <typename Index>
+        std::size_t find_inner(const Index* inner, std::size_t first, std::size_t last, std::size_t j) {
+            const Index* it = std::lower_bound(inner + first, inner + last, static_cast<Index>(j));
+            return (it != inner + last && *it == j) ? static_cast<std::size_t>(it - inner) : last;
+        }
+    }   // namespace detail
+
+    // alpha*A + beta*B as a new matrix with the storage order of A (B may have the other order). Every row
+    // (column) is the merge of the sorted rows (columns) of A and B: a first pass counts the entries, so
+    // that the result is allocated exactly, a second one fills it, both in parallel over the rows.
+    // Throws std::overflow_error if the number of non-zeros of the result exceeds the range of Index
+    template <typename T, StorageOrder OrderA, StorageOrder OrderB, typename Index>
+    SparseMatrix<T, OrderA, Index> axpby(T alpha, const SparseMatrix<T, OrderA, Index>& A, T beta, const SparseMatrix<T, OrderB, Index>& B,
+                                         std::size_t threads = 0) {
+        threads = detail::check_compressed(A, threads);
+        detail::check_same_size(A, B);
+        const CompressedArrays<T, Index, OrderA> b(B);
+        const std::size_t n = detail::outer_count(OrderA, A.get_rows(), A.get_cols());
+        const Index* a_outer = A.outer_indexes();
+        const Index* a_inner = A.inner_indexes();
+        const T* a_vals = A.values_data();
+        const std::size_t parts = std::max<std::size_t>(1, std::min(threads, n));
+        const auto bounds = parallel::balanced_partition(a_outer, n, parts);
+
+        std::vector<std::size_t> counts(n + 1, 0);
+        parallel::run(parts, [&](std::size_t t) {
+            for (std::size_t o = bounds[t]; o < bounds[t + 1]; ++o) {
+                std::size_t ka = a_outer[o], kb = b.outer[o], count = 0;
+                while (ka < a_outer[o + 1] && kb < b.outer[o + 1]) {
+                    const Index ja = a_inner[ka], jb = b.inner[kb];
+                    ka += (ja <= jb);
+                    kb += (jb <= ja);
+                    ++count;
+                }
+                counts[o + 1] = count + (a_outer[o + 1] - ka) + (b.outer[o + 1] - kb);
+            }
+        });
+        for (std::size_t o = 0; o < n; ++o)
+            counts[o + 1] += counts[o];
+        if (counts[n] > static_cast<std::size_t>(std::numeric_limits<Index>::max()))
+            throw std::overflow_error("SparseMatrix: number of non-zeros of the sum exceeds the range of the index type");
+        std::vector<Index> outer(counts.begin(), counts.end());
+
+        std::vector<Index> inner(outer[n]);
+        std::vector<T> vals(outer[n]);
+        parallel::run(parts, [&](std::size_t t) {
+            for (std::size_t o = bounds[t]; o < bounds[t + 1]; ++o) {
+                std::size_t ka = a_outer[o], kb = b.outer[o], w = outer[o];
+                while (ka < a_outer[o + 1] || kb < b.outer[o + 1]) {
+                    const bool take_a = ka < a_outer[o + 1] && (kb == b.outer[o + 1] || a_inner[ka] <= b.inner[kb]);
+                    const bool take_b = kb < b.outer[o + 1] && (ka == a_outer[o + 1] || b.inner[kb] <= a_inner[ka]);
+                    inner[w] = take_a ? a_inner[ka] : b.inner[kb];
+                    vals[w] = (take_a ? alpha * a_vals[ka++] : T(0)) + (take_b ? beta * b.values[kb++] : T(0));
+                    ++w;
+                }
+            }
+        });
+        SparseMatrix<T, OrderA, Index> C;
+        C.assign_compressed(A.get_rows(), A.get_cols(), std::move(outer), std::move(inner), std::move(vals));
+        C.set_num_threads(A.get_num_threads());
+        return C;
+    }
+
+    template <typename T, StorageOrder OrderA, StorageOrder OrderB, typename Index>
+    SparseMatrix<T, OrderA, Index> operator+(const SparseMatrix<T, OrderA, Index>& A, const SparseMatrix<T, OrderB, Index>& B) {
+        return axpby(T(1), A, T(1), B);
+    }
+
+    template <typename T, StorageOrder OrderA, StorageOrder OrderB, typename Index>
+    SparseMatrix<T, OrderA, Index> operator-(const SparseMatrix<T, OrderA, Index>& A, const SparseMatrix<T, OrderB, Index>& B) {
+        return axpby(T(1), A, T(-1), B);
+    }
+
+    // A = alpha*A + beta*B in place. When the pattern of B is contained in that of A (e.g. the same pattern)
+    // only the values of A are updated, with no allocation; otherwise A is replaced by the merge (axpby),
+    // which is not allowed for a frozen pattern (std::out_of_range)
+    template <typename T, StorageOrder OrderA, StorageOrder OrderB, typename Index>
+    void axpby_in_place(T alpha, SparseMatrix<T, OrderA, Index>& A, T beta, const SparseMatrix<T, OrderB, Index>& B, std::size_t threads = 0) {
+        threads = detail::check_compressed(A, threads);
+        detail::check_same_size(A, B);
+        // A memory-mapped A leaves the file before any pointer to its arrays is taken (B may be A itself)
+        T* a_vals = A.mutable_values();
+        const CompressedArrays<T, Index, OrderA> b(B);
+        const std::size_t n = detail::outer_count(OrderA, A.get_rows(), A.get_cols());
+        const Index* a_outer = A.outer_indexes();
+        const Index* a_inner = A.inner_indexes();
+        const std::size_t parts = std::max<std::size_t>(1, std::min(threads, n));
+        const auto bounds = parallel::balanced_partition(a_outer, n, parts);
+
+        // Same pattern: a single pass over the values
+        const bool same_pattern = (A.get_nnz() == B.get_nnz()) && std::equal(a_outer, a_outer + n + 1, b.outer) &&
+                                  std::equal(a_inner, a_inner + A.get_nnz(), b.inner);
+        std::vector<char> contained(parts, 1);
+        if (!same_pattern) {
+            parallel::run(parts, [&](std::size_t t) {
+                for (std::size_t o = bounds[t]; o < bounds[t + 1] && contained[t]; ++o) {
+                    std::size_t ka = a_outer[o];
+                    for (std::size_t kb = b.outer[o]; kb < b.outer[o + 1]; ++kb) {
+                        while (ka < a_outer[o + 1] && a_inner[ka] < b.inner[kb])
+                            ++ka;
+                        if (ka == a_outer[o + 1] || a_inner[ka] != b.inner[kb]) {
+                            contained[t] = 0;
+                            break;
+                        }
+                    }
+                }
+            });
+        }
+        if (std::find(contained.begin(), contained.end(), 0) != contained.end()) {
+            if (A.is_pattern_frozen())
+                throw std::out_of_range("Element not in the frozen pattern");
+            A = axpby(alpha, A, beta, B, threads);
+            return;
+        }
+
+        parallel::run(parts, [&](std::size_t t) {
+            if (same_pattern) {
+                for (std::size_t k = a_outer[bounds[t]]; k < a_outer[bounds[t + 1]]; ++k)
+                    a_vals[k] = alpha * a_vals[k] + beta * b.values[k];
+                return;
+            }
+            for (std::size_t o = bounds[t]; o < bounds[t + 1]; ++o) {
+                std::size_t ka = a_outer[o];
+                for (std::size_t kb = b.outer[o]; kb < b.outer[o + 1]; ++kb) {
+                    for (; a_inner[ka] < b.inner[kb]; ++ka)
+                        a_vals[ka] *= alpha;
+                    a_vals[ka] = alpha * a_vals[ka] + beta * b.values[kb];
+                    ++ka;
+                }
+                for (; ka < a_outer[o + 1]; ++ka)
+                    a_vals[ka] *= alpha;
+            }
+        });
+    }
+
+    // A = alpha*A in place
+    template <typename T, StorageOrder Order, typename Index>
+    void scale(SparseMatrix<T, Order, Index>& A, T alpha, std::size_t threads = 0) {
+        threads = detail::check_compressed(A, threads);
+        T* vals = A.mutable_values();
+        parallel::for_range(A.get_nnz(), threads, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t k = begin; k < end; ++k)
+                vals[k] *= alpha;
+        });
+    }
+
+    // Main diagonal (min(rows, cols) entries, zeros where it is not in the pattern), by binary search
+    // in every row (column)
+    template <typename T, StorageOrder Order, typename Index>
+    std::vector<T> diagonal(const SparseMatrix<T, Order, Index>& A, std::size_t threads = 0) {
+        threads = detail::check_compressed(A, threads);
+        const Index* outer = A.outer_indexes();
+        const Index* inner = A.inner_indexes();
+        const T* vals = A.values_data();
+        std::vector<T> d(std::min(A.get_rows(), A.get_cols()), T(0));
+        parallel::for_range(d.size(), threads, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                const std::size_t k = detail::find_inner(inner, outer[i], outer[i + 1], i);
+                if (k != outer[i + 1])
+                    d[i] = vals[k];
+            }
+        });
+        return d;
+    }
+
+    // A = A + sigma*I. The diagonal entries are updated in place when they are all in the pattern; otherwise
+    // the missing ones are merged in (std::out_of_range for a frozen pattern)
+    template <typename T, StorageOrder Order, typename Index>
+    void shift_diagonal(SparseMatrix<T, Order, Index>& A, T sigma, std::size_t threads = 0) {
+        threads = detail::check_compressed(A, threads);
+        const std::size_t n = std::min(A.get_rows(), A.get_cols());
+        const Index* outer = A.outer_indexes();
+        const Index* inner = A.inner_indexes();
+        std::vector<std::size_t> position(n);
+        std::vector<char> missing(std::max<std::size_t>(1, std::min(threads, n)), 0);
+        parallel::run(missing.size(), [&](std::size_t t) {
+            for (std::size_t i = n * t / missing.size(); i < n * (t + 1) / missing.size(); ++i) {
+                position[i] = detail::find_inner(inner, outer[i], outer[i + 1], i);
+                missing[t] |= (position[i] == outer[i + 1]);
+            }
+        });
+        if (std::find(missing.begin(), missing.end(), 1) == missing.end()) {
+            T* vals = A.mutable_values();
+            parallel::for_range(n, threads, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                    vals[position[i]] += sigma;
+            });
+            return;
+        }
+        if (A.is_pattern_frozen())
+            throw std::out_of_range("Element not in the frozen pattern");
+        std::vector<Index> d_outer(detail::outer_count(Order, A.get_rows(), A.get_cols()) + 1, static_cast<Index>(n));
+        std::vector<Index> d_inner(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            d_outer[i] = static_cast<Index>(i);
+            d_inner[i] = static_cast<Index>(i);
+        }
+        SparseMatrix<T, Order, Index> D;
+        D.assign_compressed(A.get_rows(), A.get_cols(), std::move(d_outer), std::move(d_inner), std::vector<T>(n, sigma));
+        A = axpby(T(1), A, T(1), D, threads);
+    }
+
+    // Sums of the rows: A*ones without the multiplications
+    template <typename T, StorageOrder Order, typename Index>
+    std::vector<T> row_sums(const SparseMatrix<T, Order, Index>& A, std::size_t threads = 0) {
+        threads = detail::check_compressed(A, threads);
+        auto identity = [](const T& v) { return v; };
+        if constexpr (Order == StorageOrder::RowMajor)
+            return detail::outer_sums<T>(A, threads, identity);
+        else
+            return detail::inner_sums<T>(A, threads, identity);
+    }
+
+    // Sums of the columns
+    template <typename T, StorageOrder Order, typename Index>
+    std::vector<T> col_sums(const SparseMatrix<T, Order, Index>& A, std::size_t threads = 0) {
+        threads = detail::check_compressed(A, threads);
+        auto identity = [](const T& v) { return v; };
+        if constexpr (Order == StorageOrder::ColumnMajor)
+            return detail::outer_sums<T>(A, threads, identity);
+        else
+            return detail::inner_sums<T>(A, threads, identity);
+    }
+
+    // Frobenius norm: square root of the sum of |a_ij|^2
+    template <typename T, StorageOrder Order, typename Index>
+    double norm_frobenius(const SparseMatrix<T, Order, Index>& A, std::size_t threads = 0) {
+        threads = detail::check_compressed(A, threads);
+        const T* vals = A.values_data();
+        const std::size_t parts = std::max<std::size_t>(1, std::min(threads, A.get_nnz()));
+        std::vector<double> partial(parts, 0.0);
+        parallel::run(parts, [&](std::size_t t) {
+            double s = 0;
+            for (std::size_t k = A.get_nnz() * t / parts; k < A.get_nnz() * (t + 1) / parts; ++k) {
+                const double a = std::abs(vals[k]);
+                s += a * a;
+            }
+            partial[t] = s;
+        });
+        double sum = 0;
+        for (double p : partial)
+            sum += p;
+        return std::sqrt(sum);
+    }
+
+    // 1-norm: largest sum of |a_ij| over a column
+    template <typename T, StorageOrder Order, typename Index>
+    double norm_one(const SparseMatrix<T, Order, Index>& A, std::size_t threads = 0) {
+        threads = detail::check_compressed(A, threads);
+        auto magnitude = [](const T& v) { return static_cast<double>(std::abs(v)); };
+        const std::vector<double> sums = (Order == StorageOrder::ColumnMajor) ? detail::outer_sums<double>(A, threads, magnitude)
+                                                                              : detail::inner_sums<double>(A, threads, magnitude);
+        return sums.empty() ? 0.0 : *std::max_element(sums.begin(), sums.end());
+    }
+
+    // Infinity norm: largest sum of |a_ij| over a row
+    template <typename T, StorageOrder Order, typename Index>
+    double norm_inf(const SparseMatrix<T, Order, Index>& A, std::size_t threads = 0) {
+        threads = detail::check_compressed(A, threads);
+        auto magnitude = [](const T& v) { return static_cast<double>(std::abs(v)); };
+        const std::vector<double> sums = (Order == StorageOrder::RowMajor) ? detail::outer_sums<double>(A, threads, magnitude)
+                                                                           : detail::inner_sums<double>(A, threads, magnitude);
+        return sums.empty() ? 0.0 : *std::max_element(sums.begin(), sums.end());
+    }
+
+}   // namespace algebra
+
+#endif  // ARITHMETIC_HPP
@@ -0,0 +1,73 @@
+#ifndef BINARYFORMAT_HPP
+#define BINARYFORMAT_HPP
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace algebra::binary // On-disk format of compressed matrices (save_binary/load_binary)
+{
+    // Layout of a file (native endianness, checked at load time):
+    //   Header | first_indexes | second_indexes | values
+    // every block starts at a multiple of alignment bytes, so that the arrays can be used in place
+    // once the file is memory-mapped
+    inline constexpr char magic[8] = {'S', 'P', 'M', 'A', 'T', 'B', 'I', 'N'};
+    inline constexpr std::uint32_t version = 1;
+    inline constexpr std::uint32_t endian_tag = 0x01020304;
+    inline constexpr std::size_t alignment = 64;
+
+    // Code of the value type stored in the file
+    enum class ValueType : std::uint32_t {
+        Other = 0,          // any other trivially copyable type (only the size is checked)
+        Float32 = 1,
+        Float64 = 2,
+        Complex64 = 3,
+        Complex128 = 4,
+        Int32 = 5,
+        Int64 = 6
+    };
+
+    template <typename T>
+    constexpr ValueType value_type() {
+        if constexpr (std::is_same_v<T, float>)
+            return ValueType::Float32;
+        else if constexpr (std::is_same_v<T, double>)
+            return ValueType::Float64;
+        else if constexpr (std::is_same_v<T, std::complex<float>>)
+            return ValueType::Complex64;
+        else if constexpr (std::is_same_v<T, std::complex<double>>)
+            return ValueType::Complex128;
+        else if constexpr (std::is_integral_v<T> && std::is_signed_v<T> && sizeof(T) == 4)
+            return ValueType::Int32;
+        else if constexpr (std::is_integral_v<T> && std::is_signed_v<T> && sizeof(T) == 8)
+            return ValueType::Int64;
+        else
+            return ValueType::Other;
+    }
+
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t endian;
+        std::uint32_t order;            // 0 = RowMajor, 1 = ColumnMajor
+        std::uint32_t value_type;       // ValueType
+        std::uint32_t value_size;       // sizeof(T)
+        std::uint32_t index_size;       // sizeof(Index)
+        std::uint64_t rows;
+        std::uint64_t cols;
+        std::uint64_t nnz;
+        std::uint64_t first_offset;     // byte offsets of the three arrays from the start of the file
+        std::uint64_t second_offset;
+        std::uint64_t values_offset;
+    };
+
+    // Rounds n up to a multiple of alignment
+    constexpr std::uint64_t align(std::uint64_t n) {
+        return (n + alignment - 1) / alignment * alignment;
+    }
+
+}   // namespace algebra::binary
+
+#endif  // BINARYFORMAT_HPP
@@ -0,0 +1,254 @@
+#ifndef BLOCKSPARSEMATRIX_HPP
+#define BLOCKSPARSEMATRIX_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include "Parallel.hpp"
+#include "RowArrays.hpp"
+#include "SparseMatrix.hpp"
+
+namespace algebra // Algebra namespace
+{
+    // Block size of a BCSR matrix, with the fill ratio it gives (stored entries / non-zeros)
+    struct BlockSize {
+        std::size_t rows = 1;
+        std::size_t cols = 1;
+        double fill_ratio = 1.0;
+    };
+
+    namespace detail {
+        // Number of R x C blocks holding at least one non-zero, for the row-wise arrays of a matrix.
+        // mark[bc] is the last block row that touched block column bc
+        template <typename Index>
+        std::size_t count_blocks(std::size_t rows, std::size_t cols, const Index* outer, const Index* inner, std::size_t R, std::size_t C) {
+            const std::size_t block_rows = (rows + R - 1) / R;
+            const std::size_t none = static_cast<std::size_t>(-1);
+            std::vector<std::size_t> mark((cols + C - 1) / C, none);
+            std::size_t blocks = 0;
+            for (std::size_t I = 0; I < block_rows; ++I) {
+                for (std::size_t i = I * R; i < std::min(rows, (I + 1) * R); ++i) {
+                    for (std::size_t k = outer[i]; k < outer[i + 1]; ++k) {
+                        const std::size_t bc = inner[k] / C;
+                        if (mark[bc] != I) {
+                            mark[bc] = I;
+                            ++blocks;
+                        }
+                    }
+                }
+            }
+            return blocks;
+        }
+    }   // namespace detail
+
+    // Fill ratio (stored entries / non-zeros) of the R x C block version of a compressed matrix:
+    // 1 means that all the blocks are dense
+    template <typename T, StorageOrder Order, typename Index>
+    double block_fill_ratio(const SparseMatrix<T, Order, Index>& A, std::size_t R, std::size_t C) {
+        const RowArrays<T, Index> csr(A);
+        const std::size_t nnz = A.get_nnz();
+        if (nnz == 0)
+            return 1.0;
+        const std::size_t blocks = detail::count_blocks(A.get_rows(), A.get_cols(), csr.outer, csr.inner, R, C);
+        return static_cast<double>(blocks * R * C) / static_cast<double>(nnz);
+    }
+
+    // Chooses among 1x1 (plain CSR), 2x2, 3x3 and 4x4 the block size with the lowest memory traffic
+    // of the product: every block reads R*C values and one index, CSR one value and one index per non-zero
+    template <typename T, StorageOrder Order, typename Index>
+    BlockSize detect_block_size(const SparseMatrix<T, Order, Index>& A) {
+        const RowArrays<T, Index> csr(A);
+        const std::size_t nnz = A.get_nnz();
+        BlockSize best;
+        if (nnz == 0)
+            return best;
+        double best_bytes = static_cast<double>(nnz) * static_cast<double>(sizeof(T) + sizeof(Index));
+        for (std::size_t b = 2; b <= 4; ++b) {
+            const std::size_t blocks = detail::count_blocks(A.get_rows(), A.get_cols(), csr.outer, csr.inner, b, b);
+            const double bytes = static_cast<double>(blocks) * static_cast<double>(b * b * sizeof(T) + sizeof(Index));
+            if (bytes < best_bytes) {
+                best_bytes = bytes;
+                best = BlockSize{b, b, static_cast<double>(blocks * b * b) / static_cast<double>(nnz)};
+            }
+        }
+        return best;
+    }
+
+    // Block Compressed Sparse Row (BCSR) copy of a compressed matrix with R x C dense blocks fixed at
+    // compile time: one column index per block instead of one per value, and a product kernel that
+    // keeps R sums in registers and reuses every loaded entry of x R times. Blocks are stored row-major
+    // and zero-filled; the last block row/column is partial when the sizes are not multiples of R, C.
+    // The matrix is read-only.
+    template <typename T, std::size_t R, std::size_t C, typename Index = std::size_t>
+    class BlockSparseMatrix {
+        static_assert(R >= 1 && C >= 1, "Block sizes must be positive");
+
+    private:
+        std::size_t num_rows = 0;
+        std::size_t num_cols = 0;
+        std::size_t nonzeros = 0;
+        std::size_t num_threads = 1;
+
+        std::vector<Index> block_ptr;       // first block of every block row, plus the end
+        std::vector<Index> block_col;       // block column of every block
+        std::vector<T> values;              // R*C values per block, row-major
+
+        std::size_t block_rows() const {
+            return (num_rows + R - 1) / R;
+        }
+
+        // Product of the block rows [begin, end)
+        void multiply_rows(const T* x, T* y, std::size_t begin, std::size_t end) const {
+            // Blocks of the last block column may stick out of x when num_cols is not a multiple of C
+            const std::size_t partial_col = (num_cols % C) ? num_cols / C : static_cast<std::size_t>(-1);
+            for (std::size_t I = begin; I < end; ++I) {
+                T acc[R] = {};
+                for (std::size_t k = block_ptr[I]; k < block_ptr[I + 1]; ++k) {
+                    const T* v = values.data() + k * R * C;
+                    const std::size_t bc = block_col[k];
+                    const T* xb = x + bc * C;
+                    if (bc != partial_col) {
+                        // Fixed trip counts, fully unrolled: the C entries of x are loaded once for the R rows
+#pragma GCC unroll 16
+                        for (std::size_t r = 0; r < R; ++r)
+#pragma GCC unroll 16
+                            for (std::size_t c = 0; c < C; ++c)
+                                acc[r] += v[r * C + c] * xb[c];
+                    } else {
+                        for (std::size_t r = 0; r < R; ++r)
+                            for (std::size_t c = 0; c < num_cols - bc * C; ++c)
+                                acc[r] += v[r * C + c] * xb[c];
+                    }
+                }
+                const std::size_t last = std::min(R, num_rows - I * R);
+                for (std::size_t r = 0; r < last; ++r)
+                    y[I * R + r] = acc[r];
+            }
+        }
+
+    public:
+        // Empty matrix
+        BlockSparseMatrix() = default;
+
+        // Converts a compressed matrix (either storage order). Throws std::invalid_argument if the matrix
+        // is not compressed or has pending insertions
+        template <StorageOrder Order>
+        explicit BlockSparseMatrix(const SparseMatrix<T, Order, Index>& A)
+            : num_rows(A.get_rows()), num_cols(A.get_cols()), nonzeros(A.get_nnz()), num_threads(A.get_num_threads()) {
+            const RowArrays<T, Index> csr(A);
+            const std::size_t brows = block_rows();
+            const std::size_t bcols = (num_cols + C - 1) / C;
+            const std::size_t blocks = detail::count_blocks(num_rows, num_cols, csr.outer, csr.inner, R, C);
+            block_ptr.assign(brows + 1, 0);
+            block_col.resize(blocks);
+            values.assign(blocks * R * C, T(0));
+
+            // position[bc] is the block of block column bc in the current block row, or none
+            const std::size_t none = static_cast<std::size_t>(-1);
+            std::vector<std::size_t> position(bcols, none);
+            std::size_t count = 0;
+            for (std::size_t I = 0; I < brows; ++I) {
+                const std::size_t first_block = count;
+                const std::size_t row_end = std::min(num_rows, (I + 1) * R);
+                // Block columns of the block row, in increasing order
+                for (std::size_t i = I * R; i < row_end; ++i) {
+                    for (std::size_t k = csr.outer[i]; k < csr.outer[i + 1]; ++k) {
+                        const std::size_t bc = csr.inner[k] / C;
+                        if (position[bc] == none) {
+                            position[bc] = count;
+                            block_col[count++] = static_cast<Index>(bc);
+                        }
+                    }
+                }
+                std::sort(block_col.begin() + first_block, block_col.begin() + count);
+                for (std::size_t b = first_block; b < count; ++b)
+                    position[block_col[b]] = b;
+                for (std::size_t i = I * R; i < row_end; ++i) {
+                    for (std::size_t k = csr.outer[i]; k < csr.outer[i + 1]; ++k) {
+                        const std::size_t j = csr.inner[k];
+                        values[position[j / C] * R * C + (i - I * R) * C + j % C] = csr.values[k];
+                    }
+                }
+                for (std::size_t b = first_block; b < count; ++b)
+                    position[block_col[b]] = none;
+                block_ptr[I + 1] = static_cast<Index>(count);
+            }
+        }
+
+        std::size_t get_rows() const {
+            return num_rows;
+        }
+
+        std::size_t get_cols() const {
+            return num_cols;
+        }
+
+        // Number of non-zero elements of the original matrix
+        std::size_t get_nnz() const {
+            return nonzeros;
+        }
+
+        // Number of stored blocks
+        std::size_t num_blocks() const {
+            return block_col.size();
+        }
+
+        // Number of stored values, explicit zeros of the blocks included
+        std::size_t stored_entries() const {
+            return values.size();
+        }
+
+        // Stored entries / non-zeros: 1 means that all the blocks are dense
+        double fill_ratio() const {
+            return nonzeros ? static_cast<double>(values.size()) / static_cast<double>(nonzeros) : 1.0;
+        }
+
+        // Method to set the number of threads used by operator* (1 means serial)
+        void set_num_threads(std::size_t threads) {
+            num_threads = std::max<std::size_t>(threads, 1);
+        }
+
+        std::size_t get_num_threads() const {
+            return num_threads;
+        }
+
+        // y = A*x without allocating the result (y has get_rows() entries). Block rows are split among
+        // the threads by number of blocks
+        void multiply_into(std::vector<T>& y, const std::vector<T>& x, std::size_t threads) const {
+            if (x.size() != num_cols || y.size() != num_rows)
+                throw std::invalid_argument("BlockSparseMatrix: vector sizes do not match the matrix");
+            const std::size_t brows = block_ptr.empty() ? 0 : block_rows();
+            const std::size_t parts = std::max<std::size_t>(1, std::min(threads, brows));
+            const auto bounds = parallel::balanced_partition(block_ptr.data(), brows, parts);
+            parallel::run(parts, [&](std::size_t t) {
+                multiply_rows(x.data(), y.data(), bounds[t], bounds[t + 1]);
+            });
+        }
+
+        // Matrix-vector product with an explicit number of threads
+        std::vector<T> multiply(const std::vector<T>& x, std::size_t threads) const {
+            std::vector<T> y(num_rows);
+            multiply_into(y, x, threads);
+            return y;
+        }
+
+        friend std::vector<T> operator*(const BlockSparseMatrix& M, const std::vector<T>& x) {
+            return M.multiply(x, M.num_threads);
+        }
+    };
+
+    // BCSR formats with the block sizes selected by detect_block_size
+    template <typename T, typename Index = std::size_t>
+    using BCSR2 = BlockSparseMatrix<T, 2, 2, Index>;
+
+    template <typename T, typename Index = std::size_t>
+    using BCSR3 = BlockSparseMatrix<T, 3, 3, Index>;
+
+    template <typename T, typename Index = std::size_t>
+    using BCSR4 = BlockSparseMatrix<T, 4, 4, Index>;
+
+}   // namespace algebra
+
+#endif  // BLOCKSPARSEMATRIX_HPP
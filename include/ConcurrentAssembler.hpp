@@ -0,0 +1,302 @@
+#ifndef CONCURRENTASSEMBLER_HPP
+#define CONCURRENTASSEMBLER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Instrumentation.hpp"
+#include "Parallel.hpp"
+#include "SparseMatrix.hpp"
+
+namespace algebra // Algebra namespace
+{
+    // Thread-parallel assembly of a compressed matrix, e.g. from the element matrices of a finite element
+    // mesh. Every thread appends its (i, j, value) contributions to its own buffer (a slot), with no locks:
+    // the buffers are arenas of fixed-size blocks, so an addition is a store and a block is allocated every
+    // block_size contributions (blocks are kept by clear() and reused by the next assembly). assemble()
+    // merges the buffers in parallel straight into CSR (CSC): contributions are bucketed by ranges of rows
+    // (columns), then every thread sorts its buckets by row, and every row by column, and sums up the
+    // duplicates. Duplicates are summed in slot order and, inside a slot, in insertion order, so the result
+    // does not depend on the number of threads of assemble(). Every slot must be used by one thread at a time
+    template <typename T, StorageOrder Order = StorageOrder::RowMajor, typename Index = std::size_t>
+    class ConcurrentAssembler {
+    private:
+        struct Entry {
+            Index outer;        // row (RowMajor) or column (ColumnMajor)
+            Index inner;
+            T value;
+        };
+
+    public:
+        // Contributions per arena block
+        static constexpr std::size_t block_size = 16384;
+
+        // Contribution buffer of one slot. Aligned to a cache line, so that slots written by different
+        // threads do not share one
+        class alignas(64) LocalBuffer {
+        private:
+            std::size_t num_rows = 0;
+            std::size_t num_cols = 0;
+            std::vector<std::unique_ptr<Entry[]>> blocks;
+            std::size_t used_blocks = 0;            // blocks holding contributions (the others are spare)
+            std::size_t fill = block_size;          // contributions in the last used block
+            Entry* current = nullptr;
+
+            void next_block() {
+                if (used_blocks == blocks.size())
+                    blocks.emplace_back(new Entry[block_size]);
+                current = blocks[used_blocks++].get();
+                fill = 0;
+            }
+
+            friend class ConcurrentAssembler;
+
+        public:
+            // Adds a contribution to A_{i,j}. Throws std::out_of_range if (i, j) is outside the matrix
+            void add(std::size_t i, std::size_t j, const T& value) {
+                if (i >= num_rows || j >= num_cols)
+                    throw std::out_of_range("Index out of range");
+                if (fill == block_size)
+                    next_block();
+                if constexpr (Order == StorageOrder::RowMajor)
+                    current[fill++] = {static_cast<Index>(i), static_cast<Index>(j), value};
+                else
+                    current[fill++] = {static_cast<Index>(j), static_cast<Index>(i), value};
+            }
+
+            // Allocates the blocks for n more contributions in advance
+            void reserve(std::size_t n) {
+                const std::size_t free_entries = (blocks.size() - used_blocks) * block_size + (used_blocks ? block_size - fill : 0);
+                for (std::size_t k = free_entries; k < n; k += block_size)
+                    blocks.emplace_back(new Entry[block_size]);
+            }
+
+            // Number of contributions in the buffer
+            std::size_t size() const {
+                return used_blocks ? (used_blocks - 1) * block_size + fill : 0;
+            }
+
+            // Drops the contributions, keeping the blocks
+            void clear() {
+                used_blocks = 0;
+                fill = block_size;
+                current = nullptr;
+            }
+
+        private:
+            // Calls f(entry) for every contribution, in insertion order
+            template <typename F>
+            void for_each(F&& f) const {
+                for (std::size_t b = 0; b < used_blocks; ++b) {
+                    const Entry* block = blocks[b].get();
+                    const std::size_t n = (b + 1 == used_blocks) ? fill : block_size;
+                    for (std::size_t k = 0; k < n; ++k)
+                        f(block[k]);
+                }
+            }
+        };
+
+    private:
+        std::size_t num_rows = 0;
+        std::size_t num_cols = 0;
+        std::vector<LocalBuffer> buffers;
+
+        // Work space of assemble(), kept for the next assembly: contributions grouped by bucket, and the
+        // buffer of every thread for the contributions of a bucket sorted by outer index
+        std::unique_ptr<Entry[]> merge_buffer;
+        std::size_t merge_capacity = 0;
+        std::vector<std::vector<Entry>> merge_scratch;
+
+        // Stable sort of the contributions of one row (column) by inner index, so that duplicates are summed
+        // in insertion order: insertion sort for the usual short rows
+        static void sort_segment(Entry* e, std::size_t n) {
+            if (n <= 64) {
+                for (std::size_t a = 1; a < n; ++a) {
+                    const Entry key = e[a];
+                    std::size_t b = a;
+                    for (; b > 0 && e[b - 1].inner > key.inner; --b)
+                        e[b] = e[b - 1];
+                    e[b] = key;
+                }
+                return;
+            }
+            std::stable_sort(e, e + n, [](const Entry& l, const Entry& r) { return l.inner < r.inner; });
+        }
+
+    public:
+        // Assembler of a rows x cols matrix with the given number of slots (usually the number of threads
+        // that add contributions). Throws std::overflow_error if the sizes do not fit in Index
+        ConcurrentAssembler(std::size_t rows, std::size_t cols, std::size_t slots = parallel::hardware_threads())
+            : num_rows(rows), num_cols(cols), buffers(std::max<std::size_t>(slots, 1)) {
+            if (std::max(rows, cols) > static_cast<std::size_t>(std::numeric_limits<Index>::max()))
+                throw std::overflow_error("ConcurrentAssembler: matrix dimension exceeds the range of the index type");
+            for (LocalBuffer& b : buffers) {
+                b.num_rows = rows;
+                b.num_cols = cols;
+            }
+        }
+
+        std::size_t get_rows() const {
+            return num_rows;
+        }
+
+        std::size_t get_cols() const {
+            return num_cols;
+        }
+
+        // Number of slots
+        std::size_t slots() const {
+            return buffers.size();
+        }
+
+        // Buffer of a slot, e.g. local(t) in the thread t of parallel::run(slots(), ...).
+        // Throws std::out_of_range if the slot does not exist
+        LocalBuffer& local(std::size_t slot) {
+            if (slot >= buffers.size())
+                throw std::out_of_range("ConcurrentAssembler: slot " + std::to_string(slot) + " out of range");
+            return buffers[slot];
+        }
+
+        // Total number of contributions in the buffers
+        std::size_t contributions() const {
+            std::size_t n = 0;
+            for (const LocalBuffer& b : buffers)
+                n += b.size();
+            return n;
+        }
+
+        // Drops all the contributions, keeping the blocks (and the work space of assemble) for the next assembly
+        void clear() {
+            for (LocalBuffer& b : buffers)
+                b.clear();
+        }
+
+        // Merges the contributions of all the slots, summing up the duplicates, into a compressed matrix with
+        // the given number of threads, and clears the buffers. Must not run while contributions are added.
+        // Throws std::overflow_error if the number of contributions does not fit in Index
+        SparseMatrix<T, Order, Index> assemble(std::size_t threads = parallel::hardware_threads()) {
+            SPARSE_TIMED_SCOPE(Assemble);
+            const std::size_t outer_size = (Order == StorageOrder::RowMajor) ? num_rows : num_cols;
+            const std::size_t num_slots = buffers.size();
+            const std::size_t total = contributions();
+            if (total > static_cast<std::size_t>(std::numeric_limits<Index>::max()))
+                throw std::overflow_error("ConcurrentAssembler: number of contributions exceeds the range of the index type");
+
+            // Buckets of 2^shift contiguous outer indexes, so that the bucket of o is o >> shift; about 8 buckets
+            // per thread even out the load of uneven rows
+            const std::size_t parts = std::max<std::size_t>(1, std::min({threads, outer_size, total / 16384 + 1}));
+            std::size_t shift = 0;
+            while ((outer_size >> shift) > 8 * parts)
+                ++shift;
+            const std::size_t num_buckets = outer_size ? ((outer_size - 1) >> shift) + 1 : 1;
+            auto bucket_of = [shift](std::size_t o) { return o >> shift; };
+            auto bucket_begin = [&](std::size_t b) { return std::min(b << shift, outer_size); };
+
+            // Contributions of every slot to every bucket, then their positions: bucket by bucket, and slot by
+            // slot inside a bucket
+            const std::size_t slot_threads = std::min(parts, num_slots);
+            std::vector<std::size_t> position(num_slots * num_buckets, 0);
+            parallel::run(slot_threads, [&](std::size_t t) {
+                for (std::size_t s = t; s < num_slots; s += slot_threads) {
+                    std::size_t* count = position.data() + s * num_buckets;
+                    buffers[s].for_each([&](const Entry& e) { ++count[bucket_of(e.outer)]; });
+                }
+            });
+            std::vector<std::size_t> bucket_start(num_buckets + 1, 0);
+            for (std::size_t b = 0; b < num_buckets; ++b) {
+                std::size_t p = bucket_start[b];
+                for (std::size_t s = 0; s < num_slots; ++s) {
+                    const std::size_t count = position[s * num_buckets + b];
+                    position[s * num_buckets + b] = p;
+                    p += count;
+                }
+                bucket_start[b + 1] = p;
+            }
+
+            // Scatter of the contributions to their buckets
+            if (merge_capacity < total) {
+                merge_buffer.reset(new Entry[total]);
+                merge_capacity = total;
+            }
+            Entry* const bucketed = merge_buffer.get();
+            parallel::run(slot_threads, [&](std::size_t t) {
+                for (std::size_t s = t; s < num_slots; s += slot_threads) {
+                    std::size_t* next = position.data() + s * num_buckets;
+                    buffers[s].for_each([&](const Entry& e) { bucketed[next[bucket_of(e.outer)]++] = e; });
+                }
+            });
+
+            // Every thread merges whole buckets (the same number of contributions for every thread): a stable
+            // counting sort by outer index into a scratch buffer, then every outer index is sorted by inner
+            // index and written back, with the duplicates summed up, at the front of the bucket
+            std::vector<Index> outer(outer_size + 1, 0);
+            std::vector<std::size_t> bucket_nnz(num_buckets, 0);
+            const auto bounds = parallel::balanced_partition(bucket_start.data(), num_buckets, parts);
+            if (merge_scratch.size() < parts)
+                merge_scratch.resize(parts);
+            parallel::run(parts, [&](std::size_t t) {
+                std::vector<Entry>& scratch = merge_scratch[t];
+                std::vector<std::size_t> starts;
+                for (std::size_t b = bounds[t]; b < bounds[t + 1]; ++b) {
+                    const std::size_t lo = bucket_begin(b), hi = bucket_begin(b + 1);
+                    const Entry* in = bucketed + bucket_start[b];
+                    const std::size_t n = bucket_start[b + 1] - bucket_start[b];
+                    starts.assign(hi - lo + 1, 0);
+                    for (std::size_t k = 0; k < n; ++k)
+                        ++starts[in[k].outer - lo + 1];
+                    for (std::size_t o = 0; o < hi - lo; ++o)
+                        starts[o + 1] += starts[o];
+                    scratch.resize(n);
+                    for (std::size_t k = 0; k < n; ++k)
+                        scratch[starts[in[k].outer - lo]++] = in[k];
+
+                    Entry* out = bucketed + bucket_start[b];
+                    std::size_t w = 0;
+                    for (std::size_t o = lo, k = 0; o < hi; ++o) {
+                        const std::size_t end = starts[o - lo];     // the scatter moved every start to the end
+                        sort_segment(scratch.data() + k, end - k);
+                        const std::size_t row_start = w;
+                        for (; k < end; ++k) {
+                            if (w > row_start && out[w - 1].inner == scratch[k].inner)
+                                out[w - 1].value += scratch[k].value;
+                            else
+                                out[w++] = scratch[k];
+                        }
+                        outer[o + 1] = static_cast<Index>(w - row_start);
+                    }
+                    bucket_nnz[b] = w;
+                }
+            });
+            for (std::size_t o = 0; o < outer_size; ++o)
+                outer[o + 1] += outer[o];
+
+            // Copy of the merged buckets into the compressed vectors
+            const std::size_t nnz = outer_size ? static_cast<std::size_t>(outer[outer_size]) : 0;
+            std::vector<Index> inner(nnz);
+            std::vector<T> values(nnz);
+            parallel::run(parts, [&](std::size_t t) {
+                for (std::size_t b = bounds[t]; b < bounds[t + 1]; ++b) {
+                    const Entry* in = bucketed + bucket_start[b];
+                    const std::size_t first = outer[bucket_begin(b)];
+                    for (std::size_t k = 0; k < bucket_nnz[b]; ++k) {
+                        inner[first + k] = in[k].inner;
+                        values[first + k] = in[k].value;
+                    }
+                }
+            });
+            clear();
+
+            SparseMatrix<T, Order, Index> A;
+            A.assign_compressed(num_rows, num_cols, std::move(outer), std::move(inner), std::move(values));
+            return A;
+        }
+    };
+
+}   // namespace algebra
+
+#endif  // CONCURRENTASSEMBLER_HPP
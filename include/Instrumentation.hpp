@@ -0,0 +1,352 @@
+#ifndef INSTRUMENTATION_HPP
+#define INSTRUMENTATION_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "chrono.hpp"
+
+// Leveled logging and hot-path instrumentation of the Sparse Matrix library.
+//
+// Logging is always available and filtered at run time (set_log_level, default Warning), so the library is
+// silent unless asked. Messages below SPARSE_LOG_MIN_LEVEL (0 = Debug ... 4 = Off) are removed at compile time.
+//
+// Timers and counters exist only when SPARSE_INSTRUMENTATION is defined (make INSTRUMENT=1): otherwise the
+// SPARSE_TIMED_SCOPE and SPARSE_COUNT macros expand to nothing and the hot paths are unchanged.
+
+#ifndef SPARSE_LOG_MIN_LEVEL
+#define SPARSE_LOG_MIN_LEVEL 0
+#endif
+
+namespace algebra::instrumentation // Logging, timers and counters
+{
+    // ----------------------------------------------------------------------------------------------------
+    // Logging
+
+    enum class LogLevel {
+        Debug,
+        Info,
+        Warning,
+        Error,
+        Off
+    };
+
+    namespace detail {
+        inline std::atomic<LogLevel>& level() {
+            static std::atomic<LogLevel> current{LogLevel::Warning};
+            return current;
+        }
+
+        inline std::ostream*& stream() {
+            static std::ostream* out = &std::clog;
+            return out;
+        }
+
+        inline std::mutex& log_mutex() {
+            static std::mutex m;
+            return m;
+        }
+
+        inline const char* level_name(LogLevel l) {
+            switch (l) {
+            case LogLevel::Debug: return "debug";
+            case LogLevel::Info: return "info";
+            case LogLevel::Warning: return "warning";
+            case LogLevel::Error: return "error";
+            default: return "";
+            }
+        }
+    }   // namespace detail
+
+    // Messages below this level are dropped (LogLevel::Off drops all of them)
+    inline void set_log_level(LogLevel l) {
+        detail::level().store(l, std::memory_order_relaxed);
+    }
+
+    inline LogLevel get_log_level() {
+        return detail::level().load(std::memory_order_relaxed);
+    }
+
+    // Stream that receives the messages (std::clog by default); it must outlive the logging calls
+    inline void set_log_stream(std::ostream& out) {
+        std::lock_guard<std::mutex> lock(detail::log_mutex());
+        detail::stream() = &out;
+    }
+
+    inline bool log_enabled(LogLevel l) {
+        return static_cast<int>(l) >= SPARSE_LOG_MIN_LEVEL && l >= get_log_level() && l != LogLevel::Off;
+    }
+
+    // Writes one message, whole, even when several threads log at once
+    inline void log(LogLevel l, const std::string& message) {
+        std::lock_guard<std::mutex> lock(detail::log_mutex());
+        *detail::stream() << "[sparse " << detail::level_name(l) << "] " << message << std::endl;
+    }
+
+    // ----------------------------------------------------------------------------------------------------
+    // Timers and counters
+
+    // Instrumented operations
+    enum class Event : std::size_t {
+        Parse,          // Matrix Market parsing
+        Compress,       // compress() and compress_from_triplets()
+        Uncompress,
+        Finalize,       // merge of the pending elements
+        Spmv,           // matrix-vector and matrix-block products
+        LookupMiss,     // call operator on a compressed matrix that did not find the element (counter only)
+        Assemble,       // merge of the buffers of a ConcurrentAssembler
+        Count
+    };
+
+    constexpr std::size_t event_count = static_cast<std::size_t>(Event::Count);
+
+    inline const char* event_name(Event e) {
+        static const char* names[] = {"parse", "compress", "uncompress", "finalize", "spmv", "lookup_miss", "assemble"};
+        return names[static_cast<std::size_t>(e)];
+    }
+
+    // Run times are binned by powers of two of nanoseconds: bucket b holds [2^b, 2^(b+1)) ns
+    constexpr std::size_t histogram_buckets = 40;
+
+    // Aggregated statistics of one event
+    struct EventSummary {
+        std::uint64_t count = 0;
+        double total_ns = 0;
+        double min_ns = std::numeric_limits<double>::infinity();
+        double max_ns = 0;
+        std::array<std::uint64_t, histogram_buckets> histogram{};
+
+        double mean_ns() const {
+            return count ? total_ns / static_cast<double>(count) : 0.0;
+        }
+    };
+
+    struct Summary {
+        std::array<EventSummary, event_count> events;
+
+        const EventSummary& operator[](Event e) const {
+            return events[static_cast<std::size_t>(e)];
+        }
+    };
+
+    namespace detail {
+        // Statistics of one event written by a single thread: relaxed loads and stores (no read-modify-write),
+        // so that the owner pays no atomic instruction and summary() can read them at any time
+        struct EventStats {
+            std::atomic<std::uint64_t> count{0};
+            std::atomic<double> total_ns{0};
+            std::atomic<double> min_ns{std::numeric_limits<double>::infinity()};
+            std::atomic<double> max_ns{0};
+            std::array<std::atomic<std::uint64_t>, histogram_buckets> histogram{};
+
+            template <typename A, typename V>
+            static void add_to(A& a, V v) {
+                a.store(a.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+            }
+
+            void add_time(double ns) {
+                add_to(count, std::uint64_t(1));
+                add_to(total_ns, ns);
+                if (ns < min_ns.load(std::memory_order_relaxed))
+                    min_ns.store(ns, std::memory_order_relaxed);
+                if (ns > max_ns.load(std::memory_order_relaxed))
+                    max_ns.store(ns, std::memory_order_relaxed);
+                const std::size_t b = ns < 1 ? 0 : std::min<std::size_t>(histogram_buckets - 1, static_cast<std::size_t>(std::log2(ns)));
+                add_to(histogram[b], std::uint64_t(1));
+            }
+
+            void read_into(EventSummary& s) const {
+                s.count += count.load(std::memory_order_relaxed);
+                s.total_ns += total_ns.load(std::memory_order_relaxed);
+                s.min_ns = std::min(s.min_ns, min_ns.load(std::memory_order_relaxed));
+                s.max_ns = std::max(s.max_ns, max_ns.load(std::memory_order_relaxed));
+                for (std::size_t b = 0; b < histogram_buckets; ++b)
+                    s.histogram[b] += histogram[b].load(std::memory_order_relaxed);
+            }
+
+            void clear() {
+                count.store(0, std::memory_order_relaxed);
+                total_ns.store(0, std::memory_order_relaxed);
+                min_ns.store(std::numeric_limits<double>::infinity(), std::memory_order_relaxed);
+                max_ns.store(0, std::memory_order_relaxed);
+                for (auto& h : histogram)
+                    h.store(0, std::memory_order_relaxed);
+            }
+        };
+
+        struct ThreadStats;
+
+        // Statistics of the live threads, and those of the threads that have exited. Never destroyed, so that
+        // threads exiting during the static destruction (e.g. the pool workers) can still retire their data
+        struct Registry {
+            std::mutex mutex;
+            std::vector<ThreadStats*> threads;
+            Summary retired;
+
+            static Registry& instance() {
+                static Registry* registry = new Registry;
+                return *registry;
+            }
+        };
+
+        struct ThreadStats {
+            std::array<EventStats, event_count> events;
+
+            ThreadStats() {
+                Registry& r = Registry::instance();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                r.threads.push_back(this);
+            }
+
+            ~ThreadStats() {
+                Registry& r = Registry::instance();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                for (std::size_t e = 0; e < event_count; ++e)
+                    events[e].read_into(r.retired.events[e]);
+                r.threads.erase(std::find(r.threads.begin(), r.threads.end(), this));
+            }
+        };
+
+        inline ThreadStats& local() {
+            thread_local ThreadStats stats;
+            return stats;
+        }
+    }   // namespace detail
+
+    // Adds a run time of an event for the calling thread
+    inline void record_time(Event e, double ns) {
+        detail::local().events[static_cast<std::size_t>(e)].add_time(ns);
+    }
+
+    // Adds n occurrences of a counter event for the calling thread
+    inline void record_count(Event e, std::uint64_t n = 1) {
+        detail::EventStats::add_to(detail::local().events[static_cast<std::size_t>(e)].count, n);
+    }
+
+    // Times the enclosing scope with a Timings::Chrono
+    class ScopedTimer {
+    private:
+        Event event;
+        Timings::Chrono chrono;
+
+    public:
+        explicit ScopedTimer(Event e) : event(e) {
+            chrono.start();
+        }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+        ~ScopedTimer() {
+            chrono.stop();
+            record_time(event, 1000.0 * chrono.wallTime());
+        }
+    };
+
+    // Statistics of all the threads (exited ones included)
+    inline Summary summary() {
+        detail::Registry& r = detail::Registry::instance();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        Summary s = r.retired;
+        for (const detail::ThreadStats* t : r.threads)
+            for (std::size_t e = 0; e < event_count; ++e)
+                t->events[e].read_into(s.events[e]);
+        return s;
+    }
+
+    // Clears the statistics (call it when no instrumented operation is running)
+    inline void reset() {
+        detail::Registry& r = detail::Registry::instance();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.retired = Summary{};
+        for (detail::ThreadStats* t : r.threads)
+            for (auto& e : t->events)
+                e.clear();
+    }
+
+    // True if the library was built with the timers and counters
+    constexpr bool enabled() {
+#ifdef SPARSE_INSTRUMENTATION
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Table of the events that occurred, with count, total/mean/min/max time and the non-empty histogram buckets
+    inline void dump(std::ostream& out) {
+        if (!enabled()) {
+            out << "Instrumentation disabled (build with -DSPARSE_INSTRUMENTATION)" << std::endl;
+            return;
+        }
+        const Summary s = summary();
+        auto format_ns = [](double ns) {
+            std::ostringstream o;
+            o << std::fixed << std::setprecision(ns < 1e3 ? 0 : 1);
+            if (ns < 1e3)
+                o << ns << "ns";
+            else if (ns < 1e6)
+                o << ns / 1e3 << "us";
+            else if (ns < 1e9)
+                o << ns / 1e6 << "ms";
+            else
+                o << ns / 1e9 << "s";
+            return o.str();
+        };
+        out << std::left << std::setw(13) << "event" << std::right << std::setw(10) << "count" << std::setw(12) << "total"
+            << std::setw(12) << "mean" << std::setw(12) << "min" << std::setw(12) << "max" << std::endl;
+        for (std::size_t e = 0; e < event_count; ++e) {
+            const EventSummary& es = s.events[e];
+            if (es.count == 0)
+                continue;
+            out << std::left << std::setw(13) << event_name(static_cast<Event>(e)) << std::right << std::setw(10) << es.count;
+            if (es.total_ns > 0) {
+                out << std::setw(12) << format_ns(es.total_ns) << std::setw(12) << format_ns(es.mean_ns()) << std::setw(12)
+                    << format_ns(es.min_ns) << std::setw(12) << format_ns(es.max_ns) << std::endl << "    ";
+                for (std::size_t b = 0; b < histogram_buckets; ++b)
+                    if (es.histogram[b])
+                        out << " [" << format_ns(std::ldexp(1.0, static_cast<int>(b))) << ",)" << ":" << es.histogram[b];
+            }
+            out << std::endl;
+        }
+    }
+
+}   // namespace algebra::instrumentation
+
+// Logs a message built with <<, e.g. SPARSE_LOG(Info, "read " << n << " entries"); the message is not built
+// when the level is disabled
+#define SPARSE_LOG(level, message)                                                                                   \
+    do {                                                                                                             \
+        if (::algebra::instrumentation::log_enabled(::algebra::instrumentation::LogLevel::level)) {                 \
+            std::ostringstream sparse_log_message;                                                                   \
+            sparse_log_message << message;                                                                           \
+            ::algebra::instrumentation::log(::algebra::instrumentation::LogLevel::level, sparse_log_message.str()); \
+        }                                                                                                            \
+    } while (false)
+
+#define SPARSE_CONCAT_(a, b) a##b
+#define SPARSE_CONCAT(a, b) SPARSE_CONCAT_(a, b)
+
+#ifdef SPARSE_INSTRUMENTATION
+// Times the rest of the enclosing scope as the given event
+#define SPARSE_TIMED_SCOPE(event) \
+    ::algebra::instrumentation::ScopedTimer SPARSE_CONCAT(sparse_timer_, __LINE__)(::algebra::instrumentation::Event::event)
+// Counts one occurrence of the given event
+#define SPARSE_COUNT(event) ::algebra::instrumentation::record_count(::algebra::instrumentation::Event::event)
+#else
+#define SPARSE_TIMED_SCOPE(event) ((void)0)
+#define SPARSE_COUNT(event) ((void)0)
+#endif
+
+#endif  // INSTRUMENTATION_HPP
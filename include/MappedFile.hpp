@@ -0,0 +1,94 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace algebra // Algebra namespace
+{
+    // How a mapping is read, passed on to the kernel with madvise
+    enum class MapAccess {
+        Sequential,     // scanned once front to back: aggressive read-ahead, pages dropped soon after reading
+        Resident        // kept mapped and read at random: the whole file is prefetched and cached normally
+    };
+
+    // Read-only memory mapping of a whole file (POSIX mmap), unmapped by the destructor
+    class MappedFile {
+    private:
+        void* addr = nullptr;
+        std::size_t length = 0;
+
+        static std::runtime_error error(const std::string& what, const std::string& filename) {
+            return std::runtime_error(what + " " + filename + ": " + std::strerror(errno));
+        }
+
+    public:
+        MappedFile() = default;
+
+        MappedFile(const std::string& filename, MapAccess access) {
+            const int fd = ::open(filename.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw error("Error opening file:", filename);
+            struct stat st;
+            if (::fstat(fd, &st) != 0) {
+                ::close(fd);
+                throw error("Error reading size of file:", filename);
+            }
+            length = static_cast<std::size_t>(st.st_size);
+            if (length > 0) {
+                addr = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (addr == MAP_FAILED) {
+                    addr = nullptr;
+                    ::close(fd);
+                    throw error("Error mapping file:", filename);
+                }
+                ::madvise(addr, length, access == MapAccess::Sequential ? MADV_SEQUENTIAL : MADV_WILLNEED);
+            }
+            // The mapping stays valid after the descriptor is closed
+            ::close(fd);
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        MappedFile(MappedFile&& other) noexcept
+            : addr(std::exchange(other.addr, nullptr)), length(std::exchange(other.length, 0)) {}
+
+        MappedFile& operator=(MappedFile&& other) noexcept {
+            if (this != &other) {
+                if (addr)
+                    ::munmap(addr, length);
+                addr = std::exchange(other.addr, nullptr);
+                length = std::exchange(other.length, 0);
+            }
+            return *this;
+        }
+
+        ~MappedFile() {
+            if (addr)
+                ::munmap(addr, length);
+        }
+
+        // Pointer to the first byte of the file
+        const char* data() const {
+            return static_cast<const char*>(addr);
+        }
+
+        // Size of the file in bytes
+        std::size_t size() const {
+            return length;
+        }
+    };
+
+}   // namespace algebra
+
+#endif  // MAPPEDFILE_HPP
@@ -0,0 +1,284 @@
+#ifndef MATRIXMARKET_HPP
+#define MATRIXMARKET_HPP
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <complex>
+#include <cstddef>
+#include <stdexcept>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "Instrumentation.hpp"
+#include "MappedFile.hpp"
+#include "Parallel.hpp"
+
+namespace algebra::mm // Matrix Market (coordinate format) reader
+{
+    // Field of the %%MatrixMarket banner
+    enum class Field {
+        Real,
+        Integer,
+        Complex,
+        Pattern
+    };
+
+    // Symmetry of the %%MatrixMarket banner
+    enum class Symmetry {
+        General,
+        Symmetric,
+        SkewSymmetric,
+        Hermitian
+    };
+
+    // Banner and size line of a Matrix Market file
+    struct Header {
+        Field field = Field::Real;
+        Symmetry symmetry = Symmetry::General;
+        std::size_t rows = 0;
+        std::size_t cols = 0;
+        std::size_t entries = 0;       // number of entries written in the file
+    };
+
+    // Entries of a matrix as flat arrays (0-based indexes)
+    template <typename T>
+    struct Triplets {
+        Header header;
+        std::vector<std::size_t> rows;
+        std::vector<std::size_t> cols;
+        std::vector<T> values;
+
+        std::size_t size() const {
+            return values.size();
+        }
+    };
+
+    namespace detail {
+        template <typename T>
+        struct is_complex : std::false_type {};
+
+        template <typename R>
+        struct is_complex<std::complex<R>> : std::true_type {};
+
+        inline std::string lower(std::string s) {
+            std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            return s;
+        }
+
+        inline bool is_blank(char c) {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        inline const char* skip_blanks(const char* p, const char* end) {
+            while (p < end && is_blank(*p))
+                ++p;
+            return p;
+        }
+
+        inline const char* next_line(const char* p, const char* end) {
+            while (p < end && *p != '\n')
+                ++p;
+            return p < end ? p + 1 : end;
+        }
+
+        // Parses one number at p and advances p; returns false on failure
+        template <typename V>
+        bool parse_number(const char*& p, const char* end, V& value) {
+            p = skip_blanks(p, end);
+            if (p < end && *p == '+')       // from_chars does not accept a leading '+'
+                ++p;
+            const auto res = std::from_chars(p, end, value);
+            if (res.ec != std::errc())
+                return false;
+            p = res.ptr;
+            return true;
+        }
+
+        inline Header parse_banner(const std::string& line) {
+            Header h;
+            std::string banner, object, format, field, symmetry;
+            std::istringstream ss(line);
+            ss >> banner >> object >> format >> field >> symmetry;
+            if (lower(object) != "matrix" || lower(format) != "coordinate")
+                throw std::runtime_error("Only Matrix Market files in coordinate format are supported");
+            field = lower(field);
+            symmetry = lower(symmetry);
+            if (field == "real" || field == "double")
+                h.field = Field::Real;
+            else if (field == "integer")
+                h.field = Field::Integer;
+            else if (field == "complex")
+                h.field = Field::Complex;
+            else if (field == "pattern")
+                h.field = Field::Pattern;
+            else
+                throw std::runtime_error("Unknown Matrix Market field: " + field);
+            if (symmetry == "general" || symmetry.empty())
+                h.symmetry = Symmetry::General;
+            else if (symmetry == "symmetric")
+                h.symmetry = Symmetry::Symmetric;
+            else if (symmetry == "skew-symmetric")
+                h.symmetry = Symmetry::SkewSymmetric;
+            else if (symmetry == "hermitian")
+                h.symmetry = Symmetry::Hermitian;
+            else
+                throw std::runtime_error("Unknown Matrix Market symmetry: " + symmetry);
+            return h;
+        }
+
+        // Parses the value of one entry according to the field of the file
+        template <typename T>
+        bool parse_value(const char*& p, const char* end, Field field, T& value) {
+            if (field == Field::Pattern) {
+                value = T(1);
+                return true;
+            }
+            double re = 0, im = 0;
+            if (!parse_number(p, end, re))
+                return false;
+            if (field == Field::Complex && !parse_number(p, end, im))
+                return false;
+            if constexpr (is_complex<T>::value)
+                value = T(re, im);
+            else
+                value = static_cast<T>(re);
+            return true;
+        }
+
+        // Value stored in the mirrored position (j,i) of a symmetric/skew/hermitian file
+        template <typename T>
+        T mirror_value(const T& v, Symmetry s) {
+            if (s == Symmetry::SkewSymmetric)
+                return -v;
+            if constexpr (is_complex<T>::value) {
+                if (s == Symmetry::Hermitian)
+                    return std::conj(v);
+            }
+            return v;
+        }
+
+        // Parses the entry lines in [begin, end) into local and counts the entries written in the file
+        // (the chunk must start at a line start)
+        template <typename T>
+        void parse_chunk(const char* begin, const char* end, const Header& h, bool expand, Triplets<T>& local, std::size_t& count, std::string& error) {
+            // Guess of the number of entries from the chunk size, to limit reallocations
+            const std::size_t guess = static_cast<std::size_t>(end - begin) / 24 + 1;
+            const std::size_t factor = (expand && h.symmetry != Symmetry::General) ? 2 : 1;
+            local.rows.reserve(guess * factor);
+            local.cols.reserve(guess * factor);
+            local.values.reserve(guess * factor);
+            for (const char* p = begin; p < end; ) {
+                const char* line = skip_blanks(p, end);
+                if (line == end || *line == '\n' || *line == '%') {
+                    p = next_line(line, end);
+                    continue;
+                }
+                const char* q = line;
+                std::size_t row = 0, col = 0;
+                T value{};
+                if (!parse_number(q, end, row) || !parse_number(q, end, col) || !parse_value(q, end, h.field, value)) {
+                    error = "Invalid Matrix Market entry: " + std::string(line, next_line(line, end));
+                    return;
+                }
+                if (row == 0 || col == 0 || row > h.rows || col > h.cols) {
+                    error = "Matrix Market entry out of range: " + std::string(line, next_line(line, end));
+                    return;
+                }
+                ++count;
+                local.rows.push_back(row - 1);
+                local.cols.push_back(col - 1);
+                local.values.push_back(value);
+                if (expand && h.symmetry != Symmetry::General && row != col) {
+                    local.rows.push_back(col - 1);
+                    local.cols.push_back(row - 1);
+                    local.values.push_back(mirror_value(value, h.symmetry));
+                }
+                p = next_line(q, end);
+            }
+        }
+    }   // namespace detail
+
+    // Reads a Matrix Market file in coordinate format. The file is memory-mapped, split into
+    // line-aligned chunks and each chunk is parsed by a different thread with std::from_chars.
+    // With expand_symmetric the entries of symmetric/skew-symmetric/hermitian files are mirrored,
+    // otherwise only the stored triangle is returned. Throws std::runtime_error on errors.
+    template <typename T>
+    Triplets<T> read(const std::string& filename, std::size_t threads = parallel::hardware_threads(), bool expand_symmetric = true) {
+        SPARSE_TIMED_SCOPE(Parse);
+        MappedFile file(filename, MapAccess::Sequential);
+        const char* p = file.data();
+        const char* end = p + file.size();
+
+        Triplets<T> result;
+        Header& h = result.header;
+
+        // Banner (first line) and comments
+        if (p < end && std::string_view(p, std::min<std::size_t>(14, end - p)) == "%%MatrixMarket") {
+            const char* eol = detail::next_line(p, end);
+            h = detail::parse_banner(std::string(p, eol));
+            p = eol;
+        }
+        if (h.field == Field::Complex && !detail::is_complex<T>::value)
+            throw std::runtime_error("Complex Matrix Market file read into a real matrix: " + filename);
+        for (const char* q = detail::skip_blanks(p, end); q < end && (*q == '%' || *q == '\n'); q = detail::skip_blanks(p, end))
+            p = detail::next_line(q, end);
+
+        // Size line: M = num of rows, N = num of cols, L = num of entries
+        if (!detail::parse_number(p, end, h.rows) || !detail::parse_number(p, end, h.cols) || !detail::parse_number(p, end, h.entries))
+            throw std::runtime_error("Invalid matrix market file format: " + filename);
+        p = detail::next_line(p, end);
+
+        // Line-aligned chunks, at least 1MB each so that small files are read by one thread
+        const std::size_t bytes = static_cast<std::size_t>(end - p);
+        const std::size_t chunks = std::max<std::size_t>(1, std::min(threads, bytes / (std::size_t(1) << 20)));
+        std::vector<const char*> bounds(chunks + 1, end);
+        bounds[0] = p;
+        for (std::size_t c = 1; c < chunks; ++c)
+            bounds[c] = std::max(bounds[c - 1], detail::next_line(p + bytes * c / chunks, end));
+
+        std::vector<Triplets<T>> local(chunks);
+        std::vector<std::size_t> counts(chunks, 0);
+        std::vector<std::string> errors(chunks);
+        const bool expand = expand_symmetric;
+        parallel::run(chunks, [&](std::size_t c) {
+            detail::parse_chunk(bounds[c], bounds[c + 1], h, expand, local[c], counts[c], errors[c]);
+        });
+        for (const auto& e : errors)
+            if (!e.empty())
+                throw std::runtime_error(e + " in " + filename);
+        std::size_t count = 0;
+        for (const auto n : counts)
+            count += n;
+        if (count != h.entries)
+            throw std::runtime_error("Expected " + std::to_string(h.entries) + " entries, found " + std::to_string(count) + " in " + filename);
+
+        // Concatenation of the chunks
+        std::vector<std::size_t> offset(chunks + 1, 0);
+        for (std::size_t c = 0; c < chunks; ++c)
+            offset[c + 1] = offset[c] + local[c].size();
+        if (chunks == 1) {
+            result.rows = std::move(local[0].rows);
+            result.cols = std::move(local[0].cols);
+            result.values = std::move(local[0].values);
+        } else {
+            result.rows.resize(offset[chunks]);
+            result.cols.resize(offset[chunks]);
+            result.values.resize(offset[chunks]);
+            parallel::run(chunks, [&](std::size_t c) {
+                std::copy(local[c].rows.begin(), local[c].rows.end(), result.rows.begin() + offset[c]);
+                std::copy(local[c].cols.begin(), local[c].cols.end(), result.cols.begin() + offset[c]);
+                std::copy(local[c].values.begin(), local[c].values.end(), result.values.begin() + offset[c]);
+                local[c] = Triplets<T>();
+            });
+        }
+
+        return result;
+    }
+
+}   // namespace algebra::mm
+
+#endif  // MATRIXMARKET_HPP
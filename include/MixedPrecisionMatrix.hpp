@@ -0,0 +1,293 @@
+#ifndef MIXEDPRECISIONMATRIX_HPP
+#define MIXEDPRECISIONMATRIX_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "Instrumentation.hpp"
+#include "Parallel.hpp"
+#include "RowArrays.hpp"
+#include "SparseMatrix.hpp"
+#include "SpMVKernels.hpp"
+
+namespace algebra // Algebra namespace
+{
+    // Brain floating point number: the upper 16 bits of a float (8 exponent bits, 7 mantissa bits), so it
+    // has the range of float with about 3 significant digits. Conversion from float rounds to nearest even
+    struct bfloat16 {
+        std::uint16_t bits = 0;
+
+        bfloat16() = default;
+
+        explicit bfloat16(float f) {
+            const std::uint32_t u = std::bit_cast<std::uint32_t>(f);
+            if (std::isnan(f))
+                bits = static_cast<std::uint16_t>((u >> 16) | 0x0040);      // quiet NaN, sign kept
+            else
+                bits = static_cast<std::uint16_t>((u + 0x7FFF + ((u >> 16) & 1)) >> 16);
+        }
+
+        explicit operator float() const {
+            return std::bit_cast<float>(static_cast<std::uint32_t>(bits) << 16);
+        }
+    };
+
+    namespace detail {
+        // Value of type T stored as S, and back
+        template <typename S, typename T>
+        S narrow(T v) {
+            if constexpr (std::is_same_v<S, bfloat16>)
+                return bfloat16(static_cast<float>(v));
+            else
+                return static_cast<S>(v);
+        }
+
+        template <typename T, typename S>
+        T widen(S v) {
+            if constexpr (std::is_same_v<S, bfloat16>)
+                return static_cast<T>(static_cast<float>(v));
+            else
+                return static_cast<T>(v);
+        }
+
+        // Row dot products of a mixed-precision CSR matrix: the stored values are widened to T in the loop
+        template <typename T, typename S, typename Index>
+        T mixed_row_dot(const S* v, const Index* c, const T* x, std::size_t n) {
+            T sum = 0;
+            for (std::size_t k = 0; k < n; ++k)
+                sum += widen<T>(v[k]) * x[c[k]];
+            return sum;
+        }
+
+#ifdef SPARSE_SIMD_X86
+        // Four stored values widened to doubles
+        SPARSE_TARGET_AVX2 inline __m256d load_widened4(const float* v) {
+            return _mm256_cvtps_pd(_mm_loadu_ps(v));
+        }
+
+        SPARSE_TARGET_AVX2 inline __m256d load_widened4(const bfloat16* v) {
+            const __m128i h = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(v));
+            return _mm256_cvtps_pd(_mm_castsi128_ps(_mm_slli_epi32(_mm_cvtepu16_epi32(h), 16)));
+        }
+
+        // Same as mixed_row_dot for double vectors: two accumulators of 4 lanes, x gathered
+        template <typename S, typename Index>
+        SPARSE_TARGET_AVX2 double mixed_row_dot_avx2(const S* v, const Index* c, const double* x, std::size_t n) {
+            __m256d acc0 = _mm256_setzero_pd();
+            __m256d acc1 = _mm256_setzero_pd();
+            std::size_t k = 0;
+            for (; k + 8 <= n; k += 8) {
+                const __m256d x0 = _mm256_i64gather_pd(x, kernels::detail::load_index4(c + k), 8);
+                const __m256d x1 = _mm256_i64gather_pd(x, kernels::detail::load_index4(c + k + 4), 8);
+                acc0 = _mm256_fmadd_pd(load_widened4(v + k), x0, acc0);
+                acc1 = _mm256_fmadd_pd(load_widened4(v + k + 4), x1, acc1);
+            }
+            if (k + 4 <= n) {
+                const __m256d x0 = _mm256_i64gather_pd(x, kernels::detail::load_index4(c + k), 8);
+                acc0 = _mm256_fmadd_pd(load_widened4(v + k), x0, acc0);
+                k += 4;
+            }
+            double sum = kernels::detail::hsum_avx2(_mm256_add_pd(acc0, acc1));
+            for (; k < n; ++k)
+                sum += widen<double>(v[k]) * x[c[k]];
+            return sum;
+        }
+
+        // Eight stored values widened to doubles (the values array is padded, so that the tail of the last
+        // row can be loaded whole)
+        SPARSE_TARGET_AVX512 inline __m512d load_widened8(const float* v) {
+            return _mm512_cvtps_pd(_mm256_loadu_ps(v));
+        }
+
+        SPARSE_TARGET_AVX512 inline __m512d load_widened8(const bfloat16* v) {
+            const __m256i w = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(v)));
+            return _mm512_cvtps_pd(_mm256_castsi256_ps(_mm256_slli_epi32(w, 16)));
+        }
+
+        // Same as mixed_row_dot_avx2 with 8 lanes and a masked gather for the tail of the row
+        template <typename S, typename Index>
+        SPARSE_TARGET_AVX512 double mixed_row_dot_avx512(const S* v, const Index* c, const double* x, std::size_t n) {
+            __m512d acc0 = _mm512_setzero_pd();
+            __m512d acc1 = _mm512_setzero_pd();
+            std::size_t k = 0;
+            for (; k + 16 <= n; k += 16) {
+                const __m512d x0 = _mm512_i64gather_pd(kernels::detail::load_index8(c + k), x, 8);
+                const __m512d x1 = _mm512_i64gather_pd(kernels::detail::load_index8(c + k + 8), x, 8);
+                acc0 = _mm512_fmadd_pd(load_widened8(v + k), x0, acc0);
+                acc1 = _mm512_fmadd_pd(load_widened8(v + k + 8), x1, acc1);
+            }
+            if (k + 8 <= n) {
+                const __m512d x0 = _mm512_i64gather_pd(kernels::detail::load_index8(c + k), x, 8);
+                acc0 = _mm512_fmadd_pd(load_widened8(v + k), x0, acc0);
+                k += 8;
+            }
+            if (k < n) {
+                const __mmask8 m = static_cast<__mmask8>((1u << (n - k)) - 1);
+                const __m512d g = _mm512_mask_i64gather_pd(_mm512_setzero_pd(), m, kernels::detail::load_index8(c + k, m), x, 8);
+                acc1 = _mm512_fmadd_pd(_mm512_maskz_mov_pd(m, load_widened8(v + k)), g, acc1);
+            }
+            return _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+        }
+#endif
+
+        // y[i] = alpha*(A*x)[i] + beta*y[i] for the rows i in [begin, end) (y is not read when beta is 0)
+        template <typename T, typename S, typename Index>
+        void mixed_csr_multiply(const S* values, const Index* outer, const Index* inner, const T* x, T* y, T alpha, T beta,
+                                std::size_t begin, std::size_t end) {
+            auto store = [&](std::size_t i, T sum) {
+                y[i] = (beta == T(0)) ? alpha * sum : alpha * sum + beta * y[i];
+            };
+#ifdef SPARSE_SIMD_X86
+            if constexpr (std::is_same_v<T, double> && kernels::detail::simd_supported<double, Index>) {
+                switch (kernels::simd_level()) {
+                case kernels::SimdLevel::AVX512:
+                    for (std::size_t i = begin; i < end; ++i)
+                        store(i, mixed_row_dot_avx512(values + outer[i], inner + outer[i], x, outer[i + 1] - outer[i]));
+                    return;
+                case kernels::SimdLevel::AVX2:
+                    for (std::size_t i = begin; i < end; ++i)
+                        store(i, mixed_row_dot_avx2(values + outer[i], inner + outer[i], x, outer[i + 1] - outer[i]));
+                    return;
+                default:
+                    break;
+                }
+            }
+#endif
+            for (std::size_t i = begin; i < end; ++i)
+                store(i, mixed_row_dot(values + outer[i], inner + outer[i], x, outer[i + 1] - outer[i]));
+        }
+    }   // namespace detail
+
+    // Read-only CSR copy of a compressed matrix with the values stored in a lower precision S (float or
+    // bfloat16) and narrower indexes (32 bits by default), for products whose speed is limited by memory
+    // traffic: 4+4 bytes per non-zero instead of 8+8 for a double matrix with std::size_t indexes (2+4
+    // with bfloat16). Vectors and accumulation stay in T: every value is widened inside the kernel, so the
+    // only error is the rounding of the matrix entries (about 6e-8 relative for float, 4e-3 for bfloat16).
+    // Suited to preconditioners and inner solves, not to the outer residual of a double solve
+    template <typename S, typename T = double, typename Index = std::uint32_t>
+    class MixedPrecisionMatrix {
+        static_assert(std::is_floating_point_v<T>, "MixedPrecisionMatrix: the vector type must be a real floating point type");
+        static_assert(std::is_floating_point_v<S> || std::is_same_v<S, bfloat16>,
+                      "MixedPrecisionMatrix: the storage type must be a real floating point type or bfloat16");
+
+    private:
+        std::size_t num_rows = 0;
+        std::size_t num_cols = 0;
+        std::size_t num_threads = 1;
+        std::vector<Index> row_ptr;         // rows+1 entries
+        std::vector<Index> col_index;       // column of every non-zero
+        std::vector<S> values;              // non-zeros rounded to S, followed by simd_padding zeros
+
+        // Values past the last non-zero read by the SIMD kernels
+        static constexpr std::size_t simd_padding = 8;
+
+    public:
+        // Empty matrix
+        MixedPrecisionMatrix() = default;
+
+        // Converts a compressed matrix (any storage order and index type), rounding the values to S.
+        // Throws std::invalid_argument if the matrix is not compressed, std::overflow_error if the sizes
+        // do not fit in Index or a finite value is out of the range of S
+        template <StorageOrder Order, typename SourceIndex>
+        explicit MixedPrecisionMatrix(const SparseMatrix<T, Order, SourceIndex>& A)
+            : num_rows(A.get_rows()), num_cols(A.get_cols()), num_threads(A.get_num_threads()) {
+            const std::size_t nnz = A.get_nnz();
+            if (std::max({num_rows, num_cols, nnz}) > static_cast<std::size_t>(std::numeric_limits<Index>::max()))
+                throw std::overflow_error("MixedPrecisionMatrix: the sizes of the matrix exceed the range of the index type");
+            const RowArrays<T, SourceIndex> csr(A);
+            row_ptr.assign(csr.outer, csr.outer + num_rows + 1);
+            col_index.resize(nnz);
+            values.assign(nnz + simd_padding, S());
+            std::atomic<bool> overflow{false};
+            parallel::for_range(nnz, num_threads, [&](std::size_t begin, std::size_t end) {
+                bool local = false;
+                for (std::size_t k = begin; k < end; ++k) {
+                    col_index[k] = static_cast<Index>(csr.inner[k]);
+                    values[k] = detail::narrow<S>(csr.values[k]);
+                    local |= std::isinf(detail::widen<T>(values[k])) && std::isfinite(csr.values[k]);
+                }
+                if (local)
+                    overflow.store(true, std::memory_order_relaxed);
+            });
+            if (overflow)
+                throw std::overflow_error("MixedPrecisionMatrix: a value exceeds the range of the storage type");
+        }
+
+        std::size_t get_rows() const {
+            return num_rows;
+        }
+
+        std::size_t get_cols() const {
+            return num_cols;
+        }
+
+        std::size_t get_nnz() const {
+            return col_index.size();
+        }
+
+        // Bytes of the stored arrays (row pointers, column indexes and values)
+        std::size_t memory_bytes() const {
+            return (row_ptr.size() + col_index.size()) * sizeof(Index) + col_index.size() * sizeof(S);
+        }
+
+        // Stored value of the element (i, j) widened to T, 0 if it is not stored (binary search in the row)
+        T operator()(std::size_t i, std::size_t j) const {
+            if (i >= num_rows || j >= num_cols)
+                return 0;
+            const Index* begin = col_index.data() + row_ptr[i];
+            const Index* end = col_index.data() + row_ptr[i + 1];
+            const Index* it = std::lower_bound(begin, end, static_cast<Index>(j));
+            return (it != end && *it == j) ? detail::widen<T>(values[it - col_index.data()]) : T(0);
+        }
+
+        // Method to set the number of threads used by operator* and multiply_into (1 means serial)
+        void set_num_threads(std::size_t threads) {
+            num_threads = std::max<std::size_t>(threads, 1);
+        }
+
+        std::size_t get_num_threads() const {
+            return num_threads;
+        }
+
+        // y = alpha*A*x + beta*y without allocating (y has get_rows() entries). Rows are split among the
+        // threads by number of non-zeros. Throws std::invalid_argument if the sizes do not match
+        void multiply_into(std::vector<T>& y, const std::vector<T>& x, T alpha, T beta, std::size_t threads) const {
+            if (x.size() != num_cols || y.size() != num_rows)
+                throw std::invalid_argument("MixedPrecisionMatrix: vector sizes do not match the matrix");
+            SPARSE_TIMED_SCOPE(Spmv);
+            const std::size_t parts = std::max<std::size_t>(1, std::min(threads, num_rows));
+            const auto bounds = parallel::balanced_partition(row_ptr.data(), num_rows, parts);
+            parallel::run(parts, [&](std::size_t t) {
+                detail::mixed_csr_multiply(values.data(), row_ptr.data(), col_index.data(), x.data(), y.data(), alpha, beta,
+                                           bounds[t], bounds[t + 1]);
+            });
+        }
+
+        // Same as multiply_into using get_num_threads() threads
+        void multiply_into(std::vector<T>& y, const std::vector<T>& x, T alpha = T(1), T beta = T(0)) const {
+            multiply_into(y, x, alpha, beta, num_threads);
+        }
+
+        // Matrix-vector product with an explicit number of threads
+        std::vector<T> multiply(const std::vector<T>& x, std::size_t threads) const {
+            std::vector<T> y(num_rows);
+            multiply_into(y, x, T(1), T(0), threads);
+            return y;
+        }
+
+        friend std::vector<T> operator*(const MixedPrecisionMatrix& M, const std::vector<T>& x) {
+            return M.multiply(x, M.num_threads);
+        }
+    };
+
+}   // namespace algebra
+
+#endif  // MIXEDPRECISIONMATRIX_HPP
@@ -0,0 +1,153 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace algebra::parallel // Threading helpers used by the Sparse Matrix kernels
+{
+    // Number of hardware threads available (at least one)
+    inline std::size_t hardware_threads() {
+        const std::size_t n = std::thread::hardware_concurrency();
+        return n == 0 ? 1 : n;
+    }
+
+    // Persistent pool of worker threads, so that a kernel called millions of times
+    // does not pay the cost of spawning threads at each call
+    class ThreadPool {
+    private:
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable start_cv;
+        std::condition_variable done_cv;
+        std::function<void(std::size_t)> task;
+        std::size_t task_threads = 0;       // number of threads taking part to the current task
+        std::size_t generation = 0;         // incremented each time a new task is published
+        std::size_t pending = 0;            // workers still running the current task
+        bool stopping = false;
+
+        static bool& inside_worker() {
+            thread_local bool flag = false;
+            return flag;
+        }
+
+        void worker_loop(std::size_t id) {
+            inside_worker() = true;
+            std::size_t seen = 0;
+            for (;;) {
+                std::unique_lock<std::mutex> lock(mutex);
+                start_cv.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping)
+                    return;
+                seen = generation;
+                // Worker "id" runs the chunk id+1, chunk 0 is run by the calling thread
+                if (id + 1 >= task_threads)
+                    continue;
+                auto job = task;
+                lock.unlock();
+                job(id + 1);
+                lock.lock();
+                if (--pending == 0)
+                    done_cv.notify_one();
+            }
+        }
+
+        void grow(std::size_t n) {
+            while (workers.size() < n) {
+                const std::size_t id = workers.size();
+                workers.emplace_back([this, id] { worker_loop(id); });
+            }
+        }
+
+    public:
+        ThreadPool() = default;
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            start_cv.notify_all();
+            for (auto& w : workers)
+                w.join();
+        }
+
+        // Pool shared by the whole library
+        static ThreadPool& instance() {
+            static ThreadPool pool;
+            return pool;
+        }
+
+        // Runs f(tid) for tid = 0,...,num_threads-1 and waits for all of them.
+        // Nested calls (from inside a worker) are executed serially.
+        template <typename F>
+        void run(std::size_t num_threads, F&& f) {
+            if (num_threads <= 1 || inside_worker()) {
+                for (std::size_t t = 0; t < std::max<std::size_t>(num_threads, 1); ++t)
+                    f(t);
+                return;
+            }
+            // Only one parallel region at a time is published to the workers
+            static std::mutex region;
+            std::lock_guard<std::mutex> region_lock(region);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                grow(num_threads - 1);
+                task = std::ref(f);
+                task_threads = num_threads;
+                pending = num_threads - 1;
+                ++generation;
+            }
+            start_cv.notify_all();
+            inside_worker() = true;
+            f(0);
+            inside_worker() = false;
+            std::unique_lock<std::mutex> lock(mutex);
+            done_cv.wait(lock, [&] { return pending == 0; });
+            task = nullptr;
+        }
+    };
+
+    // Runs f(tid) on num_threads threads of the shared pool
+    template <typename F>
+    void run(std::size_t num_threads, F&& f) {
+        ThreadPool::instance().run(num_threads, std::forward<F>(f));
+    }
+
+    // Runs f(begin, end) over num_threads contiguous chunks of [0, n) of (almost) equal size
+    template <typename F>
+    void for_range(std::size_t n, std::size_t num_threads, F&& f) {
+        num_threads = std::max<std::size_t>(1, std::min(num_threads, n));
+        run(num_threads, [&](std::size_t t) {
+            f(n * t / num_threads, n * (t + 1) / num_threads);
+        });
+    }
+
+    // Splits the outer indexes [0, n) of a compressed matrix in "parts" contiguous blocks
+    // holding (almost) the same number of non-zero elements. Since first_indexes is the
+    // prefix sum of the non-zeros per row (column), each boundary is a binary search.
+    // Returns the parts+1 boundaries.
+    template <typename Index>
+    std::vector<std::size_t> balanced_partition(const Index* first_indexes, std::size_t n, std::size_t parts) {
+        parts = std::max<std::size_t>(parts, 1);
+        std::vector<std::size_t> bounds(parts + 1, n);
+        bounds[0] = 0;
+        const std::size_t nnz = n ? static_cast<std::size_t>(first_indexes[n]) : 0;
+        for (std::size_t p = 1; p < parts; ++p) {
+            const std::size_t target = nnz * p / parts;
+            const Index* it = std::lower_bound(first_indexes, first_indexes + n + 1, static_cast<Index>(target));
+            bounds[p] = std::max(bounds[p - 1], std::min<std::size_t>(it - first_indexes, n));
+        }
+        return bounds;
+    }
+
+}   // namespace algebra::parallel
+
+#endif  // PARALLEL_HPP
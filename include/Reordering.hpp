@@ -0,0 +1,281 @@
+#ifndef REORDERING_HPP
+#define REORDERING_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "SparseMatrix.hpp"
+
+namespace algebra::reordering // Symmetric permutations of square compressed matrices
+{
+    // Permutation of the rows and columns of a matrix: perm[new_index] = old_index
+    using Permutation = std::vector<std::size_t>;
+
+    namespace detail {
+        template <typename T, StorageOrder Order, typename Index>
+        void check_matrix(const SparseMatrix<T, Order, Index>& A) {
+            if (!A.is_compressed() || A.pending_size() != 0)
+                throw std::invalid_argument("The matrix must be compressed, with no pending insertions");
+        }
+
+        // Calls f(i, j, value) for every non-zero of a compressed matrix, in storage order
+        template <typename T, StorageOrder Order, typename Index, typename F>
+        void for_each_entry(const SparseMatrix<T, Order, Index>& A, F&& f) {
+            const std::size_t outer_count = (Order == StorageOrder::RowMajor) ? A.get_rows() : A.get_cols();
+            const Index* outer = A.outer_indexes();
+            const Index* inner = A.inner_indexes();
+            const T* vals = A.values_data();
+            for (std::size_t o = 0; o < outer_count; ++o) {
+                for (std::size_t k = outer[o]; k < outer[o + 1]; ++k) {
+                    if constexpr (Order == StorageOrder::RowMajor)
+                        f(o, static_cast<std::size_t>(inner[k]), vals[k]);
+                    else
+                        f(static_cast<std::size_t>(inner[k]), o, vals[k]);
+                }
+            }
+        }
+
+        // Adjacency graph of the pattern of A + A^T without the diagonal, in CSR form with sorted neighbours
+        struct Graph {
+            std::vector<std::size_t> ptr;
+            std::vector<std::size_t> adj;
+
+            std::size_t size() const {
+                return ptr.size() - 1;
+            }
+
+            std::size_t degree(std::size_t v) const {
+                return ptr[v + 1] - ptr[v];
+            }
+        };
+
+        template <typename T, StorageOrder Order, typename Index>
+        Graph adjacency(const SparseMatrix<T, Order, Index>& A) {
+            const std::size_t n = A.get_rows();
+            Graph g;
+            g.ptr.assign(n + 1, 0);
+            for_each_entry(A, [&](std::size_t i, std::size_t j, const T&) {
+                if (i != j) {
+                    ++g.ptr[i + 1];
+                    ++g.ptr[j + 1];
+                }
+            });
+            for (std::size_t v = 0; v < n; ++v)
+                g.ptr[v + 1] += g.ptr[v];
+            g.adj.resize(g.ptr[n]);
+            std::vector<std::size_t> next(g.ptr.begin(), g.ptr.end() - 1);
+            for_each_entry(A, [&](std::size_t i, std::size_t j, const T&) {
+                if (i != j) {
+                    g.adj[next[i]++] = j;
+                    g.adj[next[j]++] = i;
+                }
+            });
+            // A symmetric pattern gives every edge twice: sort and merge the neighbours of every vertex
+            std::size_t w = 0;
+            for (std::size_t v = 0; v < n; ++v) {
+                const std::size_t first = w;
+                std::sort(g.adj.begin() + g.ptr[v], g.adj.begin() + g.ptr[v + 1]);
+                for (std::size_t k = g.ptr[v]; k < g.ptr[v + 1]; ++k)
+                    if (w == first || g.adj[w - 1] != g.adj[k])
+                        g.adj[w++] = g.adj[k];
+                g.ptr[v] = first;
+            }
+            g.ptr[n] = w;
+            g.adj.resize(w);
+            return g;
+        }
+
+        // Breadth-first level structure rooted at root: the vertices in visiting order, and the start of
+        // every level in it plus the end. mark/stamp avoid clearing the visited flags at every search
+        inline void level_structure(const Graph& g, std::size_t root, std::vector<std::size_t>& mark, std::size_t stamp,
+                                    std::vector<std::size_t>& nodes, std::vector<std::size_t>& levels) {
+            nodes.clear();
+            levels.assign(1, 0);
+            nodes.push_back(root);
+            mark[root] = stamp;
+            std::size_t head = 0;
+            while (head < nodes.size()) {
+                const std::size_t level_end = nodes.size();
+                for (; head < level_end; ++head) {
+                    const std::size_t v = nodes[head];
+                    for (std::size_t k = g.ptr[v]; k < g.ptr[v + 1]; ++k) {
+                        if (mark[g.adj[k]] != stamp) {
+                            mark[g.adj[k]] = stamp;
+                            nodes.push_back(g.adj[k]);
+                        }
+                    }
+                }
+                levels.push_back(level_end);
+            }
+        }
+
+        // Pseudo-peripheral vertex of the component of start (George and Liu): roots the level structure
+        // at the lowest-degree vertex of the last level while this increases the number of levels
+        inline std::size_t pseudo_peripheral(const Graph& g, std::size_t start, std::vector<std::size_t>& mark, std::size_t& stamp) {
+            std::vector<std::size_t> nodes, levels, candidate_nodes, candidate_levels;
+            std::size_t root = start;
+            level_structure(g, root, mark, ++stamp, nodes, levels);
+            for (;;) {
+                const std::size_t last_begin = levels[levels.size() - 2];
+                std::size_t candidate = nodes[last_begin];
+                for (std::size_t p = last_begin; p < nodes.size(); ++p)
+                    if (g.degree(nodes[p]) < g.degree(candidate))
+                        candidate = nodes[p];
+                level_structure(g, candidate, mark, ++stamp, candidate_nodes, candidate_levels);
+                if (candidate_levels.size() <= levels.size())
+                    return root;
+                root = candidate;
+                nodes.swap(candidate_nodes);
+                levels.swap(candidate_levels);
+            }
+        }
+    }   // namespace detail
+
+    // Reverse Cuthill-McKee ordering of a square compressed matrix (either storage order), computed on
+    // the pattern of A + A^T. Every connected component is numbered breadth-first from a pseudo-peripheral
+    // vertex, visiting the neighbours by increasing degree, and the whole numbering is reversed.
+    // The permuted matrix has its non-zeros close to the diagonal, so the product reads x almost sequentially
+    template <typename T, StorageOrder Order, typename Index>
+    Permutation rcm(const SparseMatrix<T, Order, Index>& A) {
+        detail::check_matrix(A);
+        if (A.get_rows() != A.get_cols())
+            throw std::invalid_argument("rcm: the matrix must be square");
+        const detail::Graph g = detail::adjacency(A);
+        const std::size_t n = g.size();
+
+        // Start vertices of the components are taken by increasing degree (counting sort)
+        std::vector<std::size_t> by_degree(n);
+        {
+            std::size_t max_degree = 0;
+            for (std::size_t v = 0; v < n; ++v)
+                max_degree = std::max(max_degree, g.degree(v));
+            std::vector<std::size_t> start(max_degree + 2, 0);
+            for (std::size_t v = 0; v < n; ++v)
+                ++start[g.degree(v) + 1];
+            for (std::size_t d = 0; d <= max_degree; ++d)
+                start[d + 1] += start[d];
+            for (std::size_t v = 0; v < n; ++v)
+                by_degree[start[g.degree(v)]++] = v;
+        }
+
+        Permutation order;
+        order.reserve(n);
+        std::vector<bool> numbered(n, false);
+        std::vector<std::size_t> mark(n, 0);
+        std::size_t stamp = 0;
+        for (std::size_t s : by_degree) {
+            if (numbered[s])
+                continue;
+            const std::size_t root = pseudo_peripheral(g, s, mark, stamp);
+            std::size_t head = order.size();
+            order.push_back(root);
+            numbered[root] = true;
+            for (; head < order.size(); ++head) {
+                const std::size_t v = order[head];
+                const std::size_t first = order.size();
+                for (std::size_t k = g.ptr[v]; k < g.ptr[v + 1]; ++k) {
+                    if (!numbered[g.adj[k]]) {
+                        numbered[g.adj[k]] = true;
+                        order.push_back(g.adj[k]);
+                    }
+                }
+                std::stable_sort(order.begin() + first, order.end(), [&](std::size_t a, std::size_t b) { return g.degree(a) < g.degree(b); });
+            }
+        }
+        std::reverse(order.begin(), order.end());
+        return order;
+    }
+
+    // Inverse permutation: inv[old_index] = new_index. Throws std::invalid_argument if perm is not a permutation
+    inline Permutation inverse(const Permutation& perm) {
+        const std::size_t none = static_cast<std::size_t>(-1);
+        Permutation inv(perm.size(), none);
+        for (std::size_t k = 0; k < perm.size(); ++k) {
+            if (perm[k] >= perm.size() || inv[perm[k]] != none)
+                throw std::invalid_argument("Not a permutation of " + std::to_string(perm.size()) + " indexes");
+            inv[perm[k]] = k;
+        }
+        return inv;
+    }
+
+    // Symmetric permutation P*A*P^T of a square compressed matrix: B(i, j) = A(perm[i], perm[j]).
+    // The result is compressed, with the storage order and the number of threads of A
+    template <typename T, StorageOrder Order, typename Index>
+    SparseMatrix<T, Order, Index> permute(const SparseMatrix<T, Order, Index>& A, const Permutation& perm) {
+        detail::check_matrix(A);
+        if (A.get_rows() != A.get_cols() || perm.size() != A.get_rows())
+            throw std::invalid_argument("permute: the matrix must be square, with one permutation entry per row");
+        const Permutation inv = inverse(perm);
+        std::vector<std::size_t> rows, cols;
+        std::vector<T> vals;
+        rows.reserve(A.get_nnz());
+        cols.reserve(A.get_nnz());
+        vals.reserve(A.get_nnz());
+        detail::for_each_entry(A, [&](std::size_t i, std::size_t j, const T& v) {
+            rows.push_back(inv[i]);
+            cols.push_back(inv[j]);
+            vals.push_back(v);
+        });
+        SparseMatrix<T, Order, Index> B;
+        B.compress_from_triplets(A.get_rows(), A.get_cols(), rows, cols, vals);
+        B.set_num_threads(A.get_num_threads());
+        return B;
+    }
+
+    // Vector in the new numbering: y[i] = x[perm[i]] (e.g. the right-hand side or the x of a product)
+    template <typename T>
+    std::vector<T> permute_vector(const std::vector<T>& x, const Permutation& perm) {
+        if (x.size() != perm.size())
+            throw std::invalid_argument("permute_vector: the vector and the permutation have different sizes");
+        std::vector<T> y(x.size());
+        for (std::size_t i = 0; i < perm.size(); ++i)
+            y[i] = x[perm[i]];
+        return y;
+    }
+
+    // Vector back in the original numbering: x[perm[i]] = y[i] (e.g. the result of a product or a solve)
+    template <typename T>
+    std::vector<T> unpermute_vector(const std::vector<T>& y, const Permutation& perm) {
+        if (y.size() != perm.size())
+            throw std::invalid_argument("unpermute_vector: the vector and the permutation have different sizes");
+        std::vector<T> x(y.size());
+        for (std::size_t i = 0; i < perm.size(); ++i)
+            x[perm[i]] = y[i];
+        return x;
+    }
+
+    // Bandwidth of a compressed matrix: largest |i - j| over the non-zeros
+    template <typename T, StorageOrder Order, typename Index>
+    std::size_t bandwidth(const SparseMatrix<T, Order, Index>& A) {
+        detail::check_matrix(A);
+        std::size_t band = 0;
+        detail::for_each_entry(A, [&](std::size_t i, std::size_t j, const T&) {
+            band = std::max(band, i > j ? i - j : j - i);
+        });
+        return band;
+    }
+
+    // Profile (envelope size) of a compressed matrix: sum over the rows i of i - f_i, where f_i is the
+    // first column of row i with a non-zero at or left of the diagonal (f_i = i for an empty row)
+    template <typename T, StorageOrder Order, typename Index>
+    std::size_t profile(const SparseMatrix<T, Order, Index>& A) {
+        detail::check_matrix(A);
+        std::vector<std::size_t> first(A.get_rows());
+        for (std::size_t i = 0; i < first.size(); ++i)
+            first[i] = i;
+        detail::for_each_entry(A, [&](std::size_t i, std::size_t j, const T&) {
+            if (j < first[i])
+                first[i] = j;
+        });
+        std::size_t sum = 0;
+        for (std::size_t i = 0; i < first.size(); ++i)
+            sum += i - first[i];
+        return sum;
+    }
+
+}   // namespace algebra::reordering
+
+#endif  // REORDERING_HPP
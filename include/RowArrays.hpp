@@ -0,0 +1,80 @@
+#ifndef ROWARRAYS_HPP
+#define ROWARRAYS_HPP
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include "SparseMatrix.hpp"
+
+namespace algebra // Algebra namespace
+{
+    // Compressed arrays of a matrix in the Target order (CSR for RowMajor, CSC for ColumnMajor), for the
+    // formats and kernels built from it: the vectors of a matrix stored in the Target order are used in
+    // place, those of the other order are transposed into owned vectors with a counting sort (the inner
+    // indexes stay sorted inside every row/column).
+    // Throws std::invalid_argument if the matrix is not compressed or has pending insertions
+    template <typename T, typename Index, StorageOrder Target>
+    class CompressedArrays {
+    private:
+        std::vector<Index> outer_copy;
+        std::vector<Index> inner_copy;
+        std::vector<T> values_copy;
+
+    public:
+        const Index* outer = nullptr;       // rows+1 (CSR) or cols+1 (CSC) entries
+        const Index* inner = nullptr;       // column (CSR) or row (CSC) of every non-zero
+        const T* values = nullptr;
+
+        template <StorageOrder Order>
+        explicit CompressedArrays(const SparseMatrix<T, Order, Index>& A) {
+            if (!A.is_compressed() || A.pending_size() != 0)
+                throw std::invalid_argument("The matrix must be compressed, with no pending insertions");
+            if constexpr (Order == Target) {
+                outer = A.outer_indexes();
+                inner = A.inner_indexes();
+                values = A.values_data();
+            } else {
+                // The outer indexes of the source are the inner ones of the target, and vice versa
+                const std::size_t target_outer = (Target == StorageOrder::RowMajor) ? A.get_rows() : A.get_cols();
+                const std::size_t source_outer = (Target == StorageOrder::RowMajor) ? A.get_cols() : A.get_rows();
+                const std::size_t nnz = A.get_nnz();
+                const Index* source_first = A.outer_indexes();
+                const Index* source_index = A.inner_indexes();
+                const T* vals = A.values_data();
+                outer_copy.assign(target_outer + 1, 0);
+                for (std::size_t k = 0; k < nnz; ++k)
+                    ++outer_copy[source_index[k] + 1];
+                for (std::size_t i = 0; i < target_outer; ++i)
+                    outer_copy[i + 1] += outer_copy[i];
+                inner_copy.resize(nnz);
+                values_copy.resize(nnz);
+                std::vector<Index> next(outer_copy.begin(), outer_copy.end() - 1);
+                for (std::size_t j = 0; j < source_outer; ++j) {
+                    for (std::size_t k = source_first[j]; k < source_first[j + 1]; ++k) {
+                        const std::size_t pos = next[source_index[k]]++;
+                        inner_copy[pos] = static_cast<Index>(j);
+                        values_copy[pos] = vals[k];
+                    }
+                }
+                outer = outer_copy.data();
+                inner = inner_copy.data();
+                values = values_copy.data();
+            }
+        }
+
+        CompressedArrays(const CompressedArrays&) = delete;
+        CompressedArrays& operator=(const CompressedArrays&) = delete;
+    };
+
+    // Row-wise (CSR) arrays of a compressed matrix
+    template <typename T, typename Index>
+    using RowArrays = CompressedArrays<T, Index, StorageOrder::RowMajor>;
+
+    // Column-wise (CSC) arrays of a compressed matrix
+    template <typename T, typename Index>
+    using ColumnArrays = CompressedArrays<T, Index, StorageOrder::ColumnMajor>;
+
+}   // namespace algebra
+
+#endif  // ROWARRAYS_HPP
@@ -0,0 +1,228 @@
+#ifndef SELLMATRIX_HPP
+#define SELLMATRIX_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Parallel.hpp"
+#include "RowArrays.hpp"
+#include "SparseMatrix.hpp"
+#include "SpMVKernels.hpp"
+
+namespace algebra // Algebra namespace
+{
+    // Sliced ELLPACK (SELL-C-sigma) copy of a compressed matrix, for SIMD matrix-vector products.
+    // Rows are grouped in chunks of C, each chunk is padded to its longest row and stored column by
+    // column, so that the kernel processes the C rows of a chunk at once with full vector loads.
+    // Within windows of sigma rows, rows are sorted by decreasing length before being chunked, which
+    // lowers the padding (sigma = 1 keeps the original order). The matrix is read-only.
+    template <typename T, typename Index = std::size_t>
+    class SellMatrix {
+    private:
+        std::size_t num_rows = 0;
+        std::size_t num_cols = 0;
+        std::size_t nonzeros = 0;
+        std::size_t chunk = 8;                  // C
+        std::size_t window = 1;                 // sigma
+        std::size_t num_threads = 1;
+
+        std::vector<std::size_t> chunk_ptr;     // start of every chunk in col_index/values, plus the end
+        std::vector<Index> col_index;           // column of every entry (padding repeats a valid column)
+        std::vector<T> values;                  // value of every entry (0 for padding)
+        std::vector<Index> row_of;              // original row of the row in position p
+
+        static void check_parameters(std::size_t C, std::size_t sigma) {
+            if (C == 0 || C > kernels::sell_max_chunk)
+                throw std::invalid_argument("SellMatrix: the chunk height must be between 1 and " + std::to_string(kernels::sell_max_chunk));
+            if (sigma == 0)
+                throw std::invalid_argument("SellMatrix: the sorting window must be at least 1");
+        }
+
+        // Sorts the rows by decreasing length inside every window of sigma rows (stable, so that
+        // rows of equal length keep their order)
+        static std::vector<Index> sorted_rows(const std::vector<std::size_t>& length, std::size_t sigma) {
+            std::vector<Index> order(length.size());
+            std::iota(order.begin(), order.end(), Index(0));
+            if (sigma > 1) {
+                for (std::size_t w = 0; w < order.size(); w += sigma) {
+                    const auto last = order.begin() + std::min(order.size(), w + sigma);
+                    std::stable_sort(order.begin() + w, last, [&](Index a, Index b) { return length[a] > length[b]; });
+                }
+            }
+            return order;
+        }
+
+        // Chunk offsets from the row lengths in sorted order
+        static std::vector<std::size_t> chunk_offsets(const std::vector<std::size_t>& length, const std::vector<Index>& order, std::size_t C) {
+            const std::size_t chunks = (order.size() + C - 1) / C;
+            std::vector<std::size_t> offsets(chunks + 1, 0);
+            for (std::size_t c = 0; c < chunks; ++c) {
+                std::size_t width = 0;
+                for (std::size_t p = c * C; p < std::min(order.size(), (c + 1) * C); ++p)
+                    width = std::max(width, length[order[p]]);
+                offsets[c + 1] = offsets[c] + width * C;
+            }
+            return offsets;
+        }
+
+        // Row lengths of a compressed matrix
+        template <StorageOrder Order>
+        static std::vector<std::size_t> row_lengths(const SparseMatrix<T, Order, Index>& A) {
+            std::vector<std::size_t> length(A.get_rows(), 0);
+            const Index* outer = A.outer_indexes();
+            if constexpr (Order == StorageOrder::RowMajor) {
+                for (std::size_t i = 0; i < length.size(); ++i)
+                    length[i] = outer[i + 1] - outer[i];
+            } else {
+                const Index* inner = A.inner_indexes();
+                for (std::size_t k = 0; k < A.get_nnz(); ++k)
+                    ++length[inner[k]];
+            }
+            return length;
+        }
+
+        template <StorageOrder Order>
+        static void check_matrix(const SparseMatrix<T, Order, Index>& A) {
+            if (!A.is_compressed() || A.pending_size() != 0)
+                throw std::invalid_argument("SellMatrix: the matrix must be compressed, with no pending insertions");
+        }
+
+        // Fills the chunks from row-wise arrays: row i has its columns in inner[outer[i]...outer[i+1])
+        void fill(const Index* outer, const Index* inner, const T* vals, std::size_t threads) {
+            const std::size_t chunks = chunk_ptr.size() - 1;
+            col_index.assign(chunk_ptr[chunks], Index(0));
+            values.assign(chunk_ptr[chunks], T(0));
+            parallel::for_range(chunks, threads, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t c = begin; c < end; ++c) {
+                    const std::size_t off = chunk_ptr[c];
+                    const std::size_t width = (chunk_ptr[c + 1] - off) / chunk;
+                    for (std::size_t r = 0; r < chunk && c * chunk + r < num_rows; ++r) {
+                        const std::size_t row = row_of[c * chunk + r];
+                        const std::size_t first = outer[row];
+                        const std::size_t len = outer[row + 1] - first;
+                        for (std::size_t j = 0; j < len; ++j) {
+                            col_index[off + j * chunk + r] = inner[first + j];
+                            values[off + j * chunk + r] = vals[first + j];
+                        }
+                        // Padding: zero times an entry of x that the row reads anyway
+                        const Index pad = len ? inner[first + len - 1] : Index(0);
+                        for (std::size_t j = len; j < width; ++j)
+                            col_index[off + j * chunk + r] = pad;
+                    }
+                }
+            });
+        }
+
+    public:
+        // Empty matrix
+        SellMatrix() = default;
+
+        // Converts a compressed matrix with chunk height C (at most kernels::sell_max_chunk) and sorting
+        // window sigma. The SIMD kernels are used when C is a multiple of the vector lanes (4 doubles,
+        // 8 floats); 8 or 16 is a good choice. Throws std::invalid_argument on invalid parameters or if
+        // the matrix is not compressed
+        template <StorageOrder Order>
+        explicit SellMatrix(const SparseMatrix<T, Order, Index>& A, std::size_t C = 8, std::size_t sigma = 256)
+            : num_rows(A.get_rows()), num_cols(A.get_cols()), nonzeros(A.get_nnz()), chunk(C), window(sigma), num_threads(A.get_num_threads()) {
+            check_parameters(C, sigma);
+            check_matrix(A);
+            const std::vector<std::size_t> length = row_lengths(A);
+            row_of = sorted_rows(length, sigma);
+            chunk_ptr = chunk_offsets(length, row_of, C);
+
+            const RowArrays<T, Index> csr(A);
+            fill(csr.outer, csr.inner, csr.values, num_threads);
+        }
+
+        // Fraction of padding entries (padding / non-zeros) that SELL-C-sigma would store for A, computed
+        // from the row lengths only, to decide whether the conversion pays off
+        template <StorageOrder Order>
+        static double predicted_padding(const SparseMatrix<T, Order, Index>& A, std::size_t C = 8, std::size_t sigma = 256) {
+            check_parameters(C, sigma);
+            check_matrix(A);
+            const std::vector<std::size_t> length = row_lengths(A);
+            const std::vector<std::size_t> offsets = chunk_offsets(length, sorted_rows(length, sigma), C);
+            const std::size_t nnz = A.get_nnz();
+            return nnz ? static_cast<double>(offsets.back() - nnz) / static_cast<double>(nnz) : 0.0;
+        }
+
+        std::size_t get_rows() const {
+            return num_rows;
+        }
+
+        std::size_t get_cols() const {
+            return num_cols;
+        }
+
+        // Number of non-zero elements (without padding)
+        std::size_t get_nnz() const {
+            return nonzeros;
+        }
+
+        // Chunk height C
+        std::size_t chunk_height() const {
+            return chunk;
+        }
+
+        // Sorting window sigma
+        std::size_t sorting_window() const {
+            return window;
+        }
+
+        // Number of stored entries, padding included
+        std::size_t stored_entries() const {
+            return values.size();
+        }
+
+        // Number of padding entries
+        std::size_t padding_entries() const {
+            return values.size() - nonzeros;
+        }
+
+        // Padding overhead: padding entries / non-zeros (0 means no padding)
+        double padding_ratio() const {
+            return nonzeros ? static_cast<double>(padding_entries()) / static_cast<double>(nonzeros) : 0.0;
+        }
+
+        // Method to set the number of threads used by operator* (1 means serial)
+        void set_num_threads(std::size_t threads) {
+            num_threads = std::max<std::size_t>(threads, 1);
+        }
+
+        std::size_t get_num_threads() const {
+            return num_threads;
+        }
+
+        // y = A*x without allocating the result (y has get_rows() entries). Chunks are split among the
+        // threads by number of stored entries
+        void multiply_into(std::vector<T>& y, const std::vector<T>& x, std::size_t threads) const {
+            if (x.size() != num_cols || y.size() != num_rows)
+                throw std::invalid_argument("SellMatrix: vector sizes do not match the matrix");
+            const std::size_t chunks = chunk_ptr.empty() ? 0 : chunk_ptr.size() - 1;
+            const std::size_t parts = std::max<std::size_t>(1, std::min(threads, chunks));
+            const auto bounds = parallel::balanced_partition(chunk_ptr.data(), chunks, parts);
+            parallel::run(parts, [&](std::size_t t) {
+                kernels::sell_multiply(values.data(), col_index.data(), chunk_ptr.data(), chunk, row_of.data(), num_rows,
+                                       x.data(), y.data(), bounds[t], bounds[t + 1]);
+            });
+        }
+
+        // Matrix-vector product with an explicit number of threads
+        std::vector<T> multiply(const std::vector<T>& x, std::size_t threads) const {
+            std::vector<T> y(num_rows);
+            multiply_into(y, x, threads);
+            return y;
+        }
+
+        friend std::vector<T> operator*(const SellMatrix& M, const std::vector<T>& x) {
+            return M.multiply(x, M.num_threads);
+        }
+    };
+
+}   // namespace algebra
+
+#endif  // SELLMATRIX_HPP
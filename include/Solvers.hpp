@@ -0,0 +1,608 @@
+#ifndef SOLVERS_HPP
+#define SOLVERS_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "Parallel.hpp"
+#include "SparseMatrix.hpp"
+#include "SpMVKernels.hpp"
+
+namespace algebra::solvers // Krylov solvers and preconditioners for compressed Sparse Matrices
+{
+    // Parameters of the iterative solvers
+    struct Options {
+        double tolerance = 1e-8;            // on the relative residual ||b - A*x|| / ||b||
+        std::size_t max_iterations = 1000;
+        std::size_t restart = 30;           // Krylov subspace size of GMRES
+        std::size_t threads = 0;            // 0 means the number of threads of the matrix (get_num_threads)
+        bool keep_history = true;           // store the relative residual of every iteration
+    };
+
+    // Outcome of a solve, with convergence history and timing
+    struct Result {
+        std::string method;
+        bool converged = false;
+        std::size_t iterations = 0;
+        double residual = 0;                // final relative residual
+        double solve_time = 0;              // wall time of the solve in milliseconds
+        std::vector<double> history;        // relative residual after every iteration
+
+        // Average wall time of one iteration in milliseconds
+        double time_per_iteration() const {
+            return iterations ? solve_time / static_cast<double>(iterations) : 0.0;
+        }
+    };
+
+    // One line summary: method, convergence, iterations, residual and times
+    inline std::ostream& operator<<(std::ostream& os, const Result& r) {
+        os << r.method << ": " << (r.converged ? "converged" : "not converged") << " in " << r.iterations
+           << " iterations, relative residual " << std::scientific << std::setprecision(3) << r.residual
+           << std::defaultfloat << ", time " << r.solve_time << " ms (" << r.time_per_iteration() << " ms/iteration)";
+        return os;
+    }
+
+    namespace detail {
+        using Clock = std::chrono::steady_clock;
+
+        inline double elapsed_ms(Clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+
+        // Sums f(begin, end) over the threads of contiguous chunks of [0, n); partial has one entry per
+        // thread and is kept by the caller, so that no allocation happens once it has grown
+        template <typename T, typename F>
+        T reduce(std::size_t n, std::size_t threads, std::vector<T>& partial, F&& f) {
+            threads = std::max<std::size_t>(1, std::min(threads, n));
+            if (threads == 1)
+                return f(std::size_t(0), n);
+            partial.assign(threads, T(0));
+            parallel::run(threads, [&](std::size_t t) {
+                partial[t] = f(n * t / threads, n * (t + 1) / threads);
+            });
+            T sum = 0;
+            for (const T& p : partial)
+                sum += p;
+            return sum;
+        }
+
+        // Inner product conj(a)*b
+        template <typename T>
+        T dot(const std::vector<T>& a, const std::vector<T>& b, std::size_t threads, std::vector<T>& partial) {
+            return reduce(a.size(), threads, partial, [&](std::size_t begin, std::size_t end) {
+                T s = 0;
+                for (std::size_t i = begin; i < end; ++i)
+                    s += kernels::conj(a[i]) * b[i];
+                return s;
+            });
+        }
+
+        template <typename T>
+        double norm(const std::vector<T>& a, std::size_t threads, std::vector<T>& partial) {
+            return std::sqrt(std::abs(std::real(dot(a, a, threads, partial))));
+        }
+
+        // Runs f(begin, end) over the threads (element-wise vector updates)
+        template <typename F>
+        void for_each(std::size_t n, std::size_t threads, F&& f) {
+            parallel::for_range(n, threads, std::forward<F>(f));
+        }
+
+        // Resizes a workspace vector; the memory is allocated only the first time (or when n grows)
+        template <typename T>
+        void prepare(std::vector<T>& v, std::size_t n) {
+            if (v.size() != n)
+                v.assign(n, T(0));
+        }
+
+        // r = b - A*x, returns ||r||
+        template <typename T, StorageOrder Order, typename Index>
+        double residual(const SparseMatrix<T, Order, Index>& A, const std::vector<T>& b, const std::vector<T>& x,
+                        std::vector<T>& r, std::size_t threads, std::vector<T>& partial) {
+            std::copy(b.begin(), b.end(), r.begin());
+            A.multiply_into(r, x, T(-1), T(1), threads);
+            return norm(r, threads, partial);
+        }
+
+        // Checks the sizes of the system and resizes x if needed (starting from zero)
+        template <typename T, StorageOrder Order, typename Index>
+        void check_system(const SparseMatrix<T, Order, Index>& A, const std::vector<T>& b, std::vector<T>& x) {
+            if (!A.is_compressed())
+                throw std::invalid_argument("Solvers need a compressed matrix");
+            if (A.get_rows() != A.get_cols() || b.size() != A.get_rows())
+                throw std::invalid_argument("Solvers need a square matrix and a right hand side of matching size");
+            if (x.size() != b.size())
+                x.assign(b.size(), T(0));
+        }
+
+        template <typename T, StorageOrder Order, typename Index>
+        std::size_t threads_of(const Options& options, const SparseMatrix<T, Order, Index>& A) {
+            return options.threads ? options.threads : A.get_num_threads();
+        }
+    }   // namespace detail
+
+    // No preconditioning: z = r
+    template <typename T>
+    class Identity {
+    public:
+        void apply(const std::vector<T>& r, std::vector<T>& z, std::size_t = 1) const {
+            std::copy(r.begin(), r.end(), z.begin());
+        }
+    };
+
+    // Jacobi (diagonal) preconditioner: z = D^{-1}*r. Throws std::invalid_argument if a diagonal element
+    // is missing or zero
+    template <typename T>
+    class Jacobi {
+    private:
+        std::vector<T> inverse_diagonal;
+
+    public:
+        template <StorageOrder Order, typename Index>
+        explicit Jacobi(const SparseMatrix<T, Order, Index>& A) : inverse_diagonal(A.get_rows()) {
+            if (!A.is_compressed() || A.get_rows() != A.get_cols())
+                throw std::invalid_argument("Jacobi: the matrix must be square and compressed");
+            const Index* outer = A.outer_indexes();
+            const Index* inner = A.inner_indexes();
+            const T* vals = A.values_data();
+            for (std::size_t i = 0; i < inverse_diagonal.size(); ++i) {
+                // The diagonal element of row (column) i is found by binary search
+                const Index* begin = inner + outer[i];
+                const Index* end = inner + outer[i + 1];
+                const Index* it = std::lower_bound(begin, end, static_cast<Index>(i));
+                if (it == end || *it != i || vals[it - inner] == T(0))
+                    throw std::invalid_argument("Jacobi: zero diagonal element in row " + std::to_string(i));
+                inverse_diagonal[i] = T(1) / vals[it - inner];
+            }
+        }
+
+        void apply(const std::vector<T>& r, std::vector<T>& z, std::size_t threads = 1) const {
+            detail::for_each(r.size(), threads, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                    z[i] = inverse_diagonal[i] * r[i];
+            });
+        }
+    };
+
+    // Incomplete LU factorization with zero fill-in, computed on a copy of the CSR arrays of a RowMajor
+    // matrix: L (unit diagonal) and U share the pattern of A. apply() solves L*U*z = r with two serial
+    // triangular sweeps. Throws std::invalid_argument on a missing or zero pivot
+    template <typename T, typename Index = std::size_t>
+    class ILU0 {
+    private:
+        std::size_t n = 0;
+        std::vector<Index> outer;
+        std::vector<Index> inner;
+        std::vector<T> lu;
+        std::vector<std::size_t> diagonal;      // position of the diagonal element of every row
+
+    public:
+        explicit ILU0(const SparseMatrix<T, StorageOrder::RowMajor, Index>& A) : n(A.get_rows()) {
+            if (!A.is_compressed() || A.get_rows() != A.get_cols())
+                throw std::invalid_argument("ILU0: the matrix must be square and compressed");
+            const std::size_t nonzeros = A.get_nnz();
+            outer.assign(A.outer_indexes(), A.outer_indexes() + n + 1);
+            inner.assign(A.inner_indexes(), A.inner_indexes() + nonzeros);
+            lu.assign(A.values_data(), A.values_data() + nonzeros);
+            diagonal.resize(n);
+            for (std::size_t i = 0; i < n; ++i) {
+                const auto first = inner.begin() + outer[i];
+                const auto last = inner.begin() + outer[i + 1];
+                const auto it = std::lower_bound(first, last, static_cast<Index>(i));
+                if (it == last || *it != i)
+                    throw std::invalid_argument("ILU0: missing diagonal element in row " + std::to_string(i));
+                diagonal[i] = static_cast<std::size_t>(it - inner.begin());
+            }
+
+            // IKJ variant: row i is updated with the rows k < i of its pattern, dropping the fill-in.
+            // position[j] is the slot of column j in row i, or npos
+            const std::size_t npos = static_cast<std::size_t>(-1);
+            std::vector<std::size_t> position(n, npos);
+            for (std::size_t i = 0; i < n; ++i) {
+                for (std::size_t p = outer[i]; p < outer[i + 1]; ++p)
+                    position[inner[p]] = p;
+                for (std::size_t p = outer[i]; p < diagonal[i]; ++p) {
+                    const std::size_t k = inner[p];
+                    if (lu[diagonal[k]] == T(0))
+                        throw std::invalid_argument("ILU0: zero pivot in row " + std::to_string(k));
+                    const T factor = lu[p] / lu[diagonal[k]];
+                    lu[p] = factor;
+                    for (std::size_t q = diagonal[k] + 1; q < outer[k + 1]; ++q) {
+                        const std::size_t target = position[inner[q]];
+                        if (target != npos)
+                            lu[target] -= factor * lu[q];
+                    }
+                }
+                for (std::size_t p = outer[i]; p < outer[i + 1]; ++p)
+                    position[inner[p]] = npos;
+            }
+            for (std::size_t i = 0; i < n; ++i)
+                if (lu[diagonal[i]] == T(0))
+                    throw std::invalid_argument("ILU0: zero pivot in row " + std::to_string(i));
+        }
+
+        // The triangular sweeps are sequential: threads is accepted for uniformity and ignored
+        void apply(const std::vector<T>& r, std::vector<T>& z, std::size_t = 1) const {
+            // L*w = r (unit diagonal), w is stored in z
+            for (std::size_t i = 0; i < n; ++i) {
+                T s = r[i];
+                for (std::size_t p = outer[i]; p < diagonal[i]; ++p)
+                    s -= lu[p] * z[inner[p]];
+                z[i] = s;
+            }
+            // U*z = w
+            for (std::size_t i = n; i-- > 0; ) {
+                T s = z[i];
+                for (std::size_t p = diagonal[i] + 1; p < outer[i + 1]; ++p)
+                    s -= lu[p] * z[inner[p]];
+                z[i] = s / lu[diagonal[i]];
+            }
+        }
+    };
+
+    // Preconditioned Conjugate Gradient for Hermitian positive definite matrices. The workspace is allocated
+    // by the first solve and reused by the following ones of the same size. A*p and p*A*p are computed in one
+    // pass (multiply_into_dot), and the updates of x and r are fused with the computation of ||r||
+    template <typename T>
+    class ConjugateGradient {
+    private:
+        std::vector<T> r, z, p, q, partial;
+
+    public:
+        Options options;
+
+        ConjugateGradient() = default;
+        explicit ConjugateGradient(const Options& opts) : options(opts) {}
+
+        template <StorageOrder Order, typename Index, typename Preconditioner>
+        Result solve(const SparseMatrix<T, Order, Index>& A, const std::vector<T>& b, std::vector<T>& x, const Preconditioner& M) {
+            const auto start = detail::Clock::now();
+            detail::check_system(A, b, x);
+            const std::size_t n = b.size();
+            const std::size_t threads = detail::threads_of(options, A);
+            constexpr bool plain = std::is_same_v<Preconditioner, Identity<T>>;
+            detail::prepare(r, n);
+            detail::prepare(p, n);
+            detail::prepare(q, n);
+            if constexpr (!plain)
+                detail::prepare(z, n);
+
+            Result result;
+            result.method = "CG";
+            const double bnorm = detail::norm(b, threads, partial);
+            const double scale = bnorm > 0 ? bnorm : 1.0;
+            double rnorm = detail::residual(A, b, x, r, threads, partial);
+            // Without preconditioner z is r itself
+            std::vector<T>& zz = plain ? r : z;
+            if constexpr (!plain)
+                M.apply(r, z, threads);
+            std::copy(zz.begin(), zz.end(), p.begin());
+            T rz = detail::dot(r, zz, threads, partial);
+
+            while (rnorm / scale > options.tolerance && result.iterations < options.max_iterations) {
+                const T pq = A.multiply_into_dot(q, p, T(1), T(0), threads);
+                if (pq == T(0))
+                    break;
+                const T alpha = rz / pq;
+                // x += alpha*p, r -= alpha*q and ||r||^2 in one pass
+                const T rr = detail::reduce(n, threads, partial, [&](std::size_t begin, std::size_t end) {
+                    T s = 0;
+                    for (std::size_t i = begin; i < end; ++i) {
+                        x[i] += alpha * p[i];
+                        r[i] -= alpha * q[i];
+                        s += kernels::conj(r[i]) * r[i];
+                    }
+                    return s;
+                });
+                rnorm = std::sqrt(std::abs(std::real(rr)));
+                ++result.iterations;
+                if (options.keep_history)
+                    result.history.push_back(rnorm / scale);
+                if (rnorm / scale <= options.tolerance)
+                    break;
+                T rz_new = rr;
+                if constexpr (!plain) {
+                    M.apply(r, z, threads);
+                    rz_new = detail::dot(r, z, threads, partial);
+                }
+                const T beta = rz_new / rz;
+                rz = rz_new;
+                detail::for_each(n, threads, [&](std::size_t begin, std::size_t end) {
+                    for (std::size_t i = begin; i < end; ++i)
+                        p[i] = zz[i] + beta * p[i];
+                });
+            }
+
+            result.residual = rnorm / scale;
+            result.converged = result.residual <= options.tolerance;
+            result.solve_time = detail::elapsed_ms(start);
+            return result;
+        }
+
+        template <StorageOrder Order, typename Index>
+        Result solve(const SparseMatrix<T, Order, Index>& A, const std::vector<T>& b, std::vector<T>& x) {
+            return solve(A, b, x, Identity<T>());
+        }
+    };
+
+    // Right-preconditioned BiCGSTAB for general square matrices, with preallocated workspace and fused updates
+    template <typename T>
+    class BiCGSTAB {
+    private:
+        std::vector<T> r, r0, p, v, s, t, phat, shat, partial;
+
+    public:
+        Options options;
+
+        BiCGSTAB() = default;
+        explicit BiCGSTAB(const Options& opts) : options(opts) {}
+
+        template <StorageOrder Order, typename Index, typename Preconditioner>
+        Result solve(const SparseMatrix<T, Order, Index>& A, const std::vector<T>& b, std::vector<T>& x, const Preconditioner& M) {
+            const auto start = detail::Clock::now();
+            detail::check_system(A, b, x);
+            const std::size_t n = b.size();
+            const std::size_t threads = detail::threads_of(options, A);
+            for (auto* w : {&r, &r0, &p, &v, &s, &t, &phat, &shat})
+                detail::prepare(*w, n);
+
+            Result result;
+            result.method = "BiCGSTAB";
+            const double bnorm = detail::norm(b, threads, partial);
+            const double scale = bnorm > 0 ? bnorm : 1.0;
+            double rnorm = detail::residual(A, b, x, r, threads, partial);
+            std::copy(r.begin(), r.end(), r0.begin());
+            std::fill(p.begin(), p.end(), T(0));
+            std::fill(v.begin(), v.end(), T(0));
+            T rho = 1, alpha = 1, omega = 1;
+
+            while (rnorm / scale > options.tolerance && result.iterations < options.max_iterations) {
+                const T rho_new = detail::dot(r0, r, threads, partial);
+                if (rho_new == T(0))
+                    break;                          // breakdown: r is orthogonal to the shadow residual
+                const T beta = (rho_new / rho) * (alpha / omega);
+                rho = rho_new;
+                detail::for_each(n, threads, [&](std::size_t begin, std::size_t end) {
+                    for (std::size_t i = begin; i < end; ++i)
+                        p[i] = r[i] + beta * (p[i] - omega * v[i]);
+                });
+                M.apply(p, phat, threads);
+                A.multiply_into(v, phat, T(1), T(0), threads);
+                const T r0v = detail::dot(r0, v, threads, partial);
+                if (r0v == T(0))
+                    break;
+                alpha = rho / r0v;
+                // s = r - alpha*v and ||s||^2 in one pass
+                const T ss = detail::reduce(n, threads, partial, [&](std::size_t begin, std::size_t end) {
+                    T sum = 0;
+                    for (std::size_t i = begin; i < end; ++i) {
+                        s[i] = r[i] - alpha * v[i];
+                        sum += kernels::conj(s[i]) * s[i];
+                    }
+                    return sum;
+                });
+                ++result.iterations;
+                const double snorm = std::sqrt(std::abs(std::real(ss)));
+                if (snorm / scale <= options.tolerance) {
+                    detail::for_each(n, threads, [&](std::size_t begin, std::size_t end) {
+                        for (std::size_t i = begin; i < end; ++i)
+                            x[i] += alpha * phat[i];
+                    });
+                    std::copy(s.begin(), s.end(), r.begin());
+                    rnorm = snorm;
+                    if (options.keep_history)
+                        result.history.push_back(rnorm / scale);
+                    break;
+                }
+                M.apply(s, shat, threads);
+                A.multiply_into(t, shat, T(1), T(0), threads);
+                // t*s and t*t in one pass
+                T ts = 0, tt = 0;
+                {
+                    std::vector<T>& part = partial;     // two partial sums per thread
+                    const std::size_t parts = std::max<std::size_t>(1, std::min(threads, n));
+                    part.assign(2 * parts, T(0));
+                    parallel::run(parts, [&](std::size_t k) {
+                        T a = 0, c = 0;
+                        for (std::size_t i = n * k / parts; i < n * (k + 1) / parts; ++i) {
+                            a += kernels::conj(t[i]) * s[i];
+                            c += kernels::conj(t[i]) * t[i];
+                        }
+                        part[2 * k] = a;
+                        part[2 * k + 1] = c;
+                    });
+                    for (std::size_t k = 0; k < parts; ++k) {
+                        ts += part[2 * k];
+                        tt += part[2 * k + 1];
+                    }
+                }
+                omega = (tt == T(0)) ? T(0) : ts / tt;
+                // x += alpha*phat + omega*shat, r = s - omega*t and ||r||^2 in one pass
+                const T rr = detail::reduce(n, threads, partial, [&](std::size_t begin, std::size_t end) {
+                    T sum = 0;
+                    for (std::size_t i = begin; i < end; ++i) {
+                        x[i] += alpha * phat[i] + omega * shat[i];
+                        r[i] = s[i] - omega * t[i];
+                        sum += kernels::conj(r[i]) * r[i];
+                    }
+                    return sum;
+                });
+                rnorm = std::sqrt(std::abs(std::real(rr)));
+                if (options.keep_history)
+                    result.history.push_back(rnorm / scale);
+                if (omega == T(0))
+                    break;
+            }
+
+            result.residual = rnorm / scale;
+            result.converged = result.residual <= options.tolerance;
+            result.solve_time = detail::elapsed_ms(start);
+            return result;
+        }
+
+        template <StorageOrder Order, typename Index>
+        Result solve(const SparseMatrix<T, Order, Index>& A, const std::vector<T>& b, std::vector<T>& x) {
+            return solve(A, b, x, Identity<T>());
+        }
+    };
+
+    // Restarted GMRES(m) with right preconditioning, modified Gram-Schmidt and Givens rotations.
+    // The m+1 Krylov vectors and the Hessenberg matrix are allocated once and reused across restarts
+    template <typename T>
+    class GMRES {
+    private:
+        std::vector<std::vector<T>> basis;      // Krylov vectors v_0,...,v_m
+        std::vector<T> hessenberg;              // (m+1) x m, column-major
+        std::vector<T> cs, sn, g, y, w, z, partial;
+
+        // Givens rotation [c s; -conj(s) c] that zeroes b in (a, b); c is real
+        static void rotation(const T& a, const T& b, T& c, T& s) {
+            const double abs_a = std::abs(a);
+            const double abs_b = std::abs(b);
+            if (abs_b == 0) {
+                c = T(1);
+                s = T(0);
+            } else if (abs_a == 0) {
+                c = T(0);
+                s = T(1);
+            } else {
+                const double nrm = std::hypot(abs_a, abs_b);
+                c = T(abs_a / nrm);
+                s = (a / abs_a) * kernels::conj(b) / nrm;
+            }
+        }
+
+    public:
+        Options options;
+
+        GMRES() = default;
+        explicit GMRES(const Options& opts) : options(opts) {}
+
+        template <StorageOrder Order, typename Index, typename Preconditioner>
+        Result solve(const SparseMatrix<T, Order, Index>& A, const std::vector<T>& b, std::vector<T>& x, const Preconditioner& M) {
+            const auto start = detail::Clock::now();
+            detail::check_system(A, b, x);
+            const std::size_t n = b.size();
+            const std::size_t threads = detail::threads_of(options, A);
+            const std::size_t m = std::max<std::size_t>(1, options.restart);
+            basis.resize(m + 1);
+            for (auto& vec : basis)
+                detail::prepare(vec, n);
+            detail::prepare(hessenberg, (m + 1) * m);
+            for (auto* vec : {&cs, &sn, &y})
+                detail::prepare(*vec, m);
+            detail::prepare(g, m + 1);
+            detail::prepare(w, n);
+            detail::prepare(z, n);
+            auto H = [&](std::size_t i, std::size_t j) -> T& { return hessenberg[j * (m + 1) + i]; };
+
+            Result result;
+            result.method = "GMRES(" + std::to_string(m) + ")";
+            const double bnorm = detail::norm(b, threads, partial);
+            const double scale = bnorm > 0 ? bnorm : 1.0;
+            double rnorm = detail::residual(A, b, x, basis[0], threads, partial);
+
+            while (rnorm / scale > options.tolerance && result.iterations < options.max_iterations) {
+                // v_0 = r/||r||, g = ||r||*e_1
+                const T inv = T(1.0 / rnorm);
+                detail::for_each(n, threads, [&](std::size_t begin, std::size_t end) {
+                    for (std::size_t i = begin; i < end; ++i)
+                        basis[0][i] *= inv;
+                });
+                std::fill(g.begin(), g.end(), T(0));
+                g[0] = T(rnorm);
+
+                std::size_t k = 0;
+                for (; k < m && result.iterations < options.max_iterations; ++k) {
+                    // w = A*M^{-1}*v_k, orthogonalized against v_0,...,v_k
+                    M.apply(basis[k], z, threads);
+                    A.multiply_into(w, z, T(1), T(0), threads);
+                    for (std::size_t i = 0; i <= k; ++i) {
+                        const T h = detail::dot(basis[i], w, threads, partial);
+                        H(i, k) = h;
+                        const std::vector<T>& vi = basis[i];
+                        detail::for_each(n, threads, [&](std::size_t begin, std::size_t end) {
+                            for (std::size_t l = begin; l < end; ++l)
+                                w[l] -= h * vi[l];
+                        });
+                    }
+                    const double hnorm = detail::norm(w, threads, partial);
+                    H(k + 1, k) = T(hnorm);
+                    if (hnorm > 0) {
+                        const T hinv = T(1.0 / hnorm);
+                        std::vector<T>& next = basis[k + 1];
+                        detail::for_each(n, threads, [&](std::size_t begin, std::size_t end) {
+                            for (std::size_t l = begin; l < end; ++l)
+                                next[l] = w[l] * hinv;
+                        });
+                    }
+                    // Previous rotations on the new column, then the rotation that zeroes H(k+1, k)
+                    for (std::size_t i = 0; i < k; ++i) {
+                        const T a = H(i, k), c = H(i + 1, k);
+                        H(i, k) = cs[i] * a + sn[i] * c;
+                        H(i + 1, k) = -kernels::conj(sn[i]) * a + cs[i] * c;
+                    }
+                    rotation(H(k, k), H(k + 1, k), cs[k], sn[k]);
+                    H(k, k) = cs[k] * H(k, k) + sn[k] * H(k + 1, k);
+                    H(k + 1, k) = T(0);
+                    g[k + 1] = -kernels::conj(sn[k]) * g[k];
+                    g[k] = cs[k] * g[k];
+                    ++result.iterations;
+                    // |g_{k+1}| is the residual norm of the current iterate
+                    rnorm = std::abs(g[k + 1]);
+                    if (options.keep_history)
+                        result.history.push_back(rnorm / scale);
+                    if (rnorm / scale <= options.tolerance || hnorm == 0) {
+                        ++k;
+                        break;
+                    }
+                }
+
+                // y = H^{-1}*g (upper triangular k x k), x += M^{-1}*(V*y)
+                for (std::size_t i = k; i-- > 0; ) {
+                    T sum = g[i];
+                    for (std::size_t j = i + 1; j < k; ++j)
+                        sum -= H(i, j) * y[j];
+                    y[i] = sum / H(i, i);
+                }
+                detail::for_each(n, threads, [&](std::size_t begin, std::size_t end) {
+                    for (std::size_t l = begin; l < end; ++l) {
+                        T sum = 0;
+                        for (std::size_t j = 0; j < k; ++j)
+                            sum += y[j] * basis[j][l];
+                        w[l] = sum;
+                    }
+                });
+                M.apply(w, z, threads);
+                detail::for_each(n, threads, [&](std::size_t begin, std::size_t end) {
+                    for (std::size_t l = begin; l < end; ++l)
+                        x[l] += z[l];
+                });
+                // True residual at every restart, also the starting vector of the next cycle
+                rnorm = detail::residual(A, b, x, basis[0], threads, partial);
+            }
+
+            result.residual = rnorm / scale;
+            result.converged = result.residual <= options.tolerance;
+            result.solve_time = detail::elapsed_ms(start);
+            return result;
+        }
+
+        template <StorageOrder Order, typename Index>
+        Result solve(const SparseMatrix<T, Order, Index>& A, const std::vector<T>& b, std::vector<T>& x) {
+            return solve(A, b, x, Identity<T>());
+        }
+    };
+
+}   // namespace algebra::solvers
+
+#endif  // SOLVERS_HPP
@@ -0,0 +1,234 @@
+#ifndef SPGEMM_HPP
+#define SPGEMM_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Parallel.hpp"
+#include "RowArrays.hpp"
+#include "SparseMatrix.hpp"
+
+namespace algebra // Algebra namespace
+{
+    namespace detail {
+        // Accumulator of one row (column) of the product, owned by a thread: a dense array indexed by the
+        // inner index when the row can fill a good part of it, an open-addressing hash table sized on the
+        // row otherwise (the dense array of a large matrix would miss the cache at every access)
+        template <typename T, typename Index>
+        class SpgemmAccumulator {
+        private:
+            static constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+            static constexpr std::size_t hash_ratio = 16;     // hash table when flops * hash_ratio < inner size
+
+            std::size_t inner_size;
+            bool use_hash = false;
+            std::size_t stamp = 0;                  // id of the current row in the dense marker
+            std::vector<std::size_t> marker;        // dense: last row that touched the index
+            std::vector<T> dense;
+            std::size_t mask = 0;
+            std::vector<std::size_t> keys;          // hash: index stored in every slot, or none
+            std::vector<T> hashed;
+            std::vector<std::size_t> used;          // hash: occupied slots, to clear them after the row
+
+            std::size_t slot_of(std::size_t j) const {
+                std::size_t s = (j * 0x9E3779B97F4A7C15ull) & mask;
+                while (keys[s] != none && keys[s] != j)
+                    s = (s + 1) & mask;
+                return s;
+            }
+
+        public:
+            explicit SpgemmAccumulator(std::size_t inner) : inner_size(inner) {}
+
+            // Starts a row that receives at most flops contributions
+            void begin_row(std::size_t flops) {
+                use_hash = flops * hash_ratio < inner_size;
+                if (use_hash) {
+                    std::size_t size = 16;
+                    while (size < 2 * flops)
+                        size *= 2;
+                    if (keys.size() < size) {
+                        keys.assign(size, none);
+                        hashed.resize(size);
+                    }
+                    mask = size - 1;
+                } else {
+                    if (marker.empty()) {
+                        marker.assign(inner_size, none);
+                        dense.resize(inner_size);
+                    }
+                    ++stamp;
+                }
+            }
+
+            // Adds v at inner index j; returns true if j was not in the row yet
+            bool add(std::size_t j, const T& v) {
+                if (use_hash) {
+                    const std::size_t s = slot_of(j);
+                    if (keys[s] == none) {
+                        keys[s] = j;
+                        hashed[s] = v;
+                        used.push_back(s);
+                        return true;
+                    }
+                    hashed[s] += v;
+                    return false;
+                }
+                if (marker[j] != stamp) {
+                    marker[j] = stamp;
+                    dense[j] = v;
+                    return true;
+                }
+                dense[j] += v;
+                return false;
+            }
+
+            // Value accumulated at an inner index of the row
+            T value(std::size_t j) const {
+                return use_hash ? hashed[slot_of(j)] : dense[j];
+            }
+
+            // Ends the row (clears the used slots of the hash table; the dense marker moves to a new stamp)
+            void end_row() {
+                for (std::size_t s : used)
+                    keys[s] = none;
+                used.clear();
+            }
+        };
+
+        // Gustavson product on compressed arrays in the same order: outer o of the result is the sum, over the
+        // entries k of outer o of the driver, of driver.values[k] times the outer driver.inner[k] of other.
+        // C = A*B is computed row by row with driver = CSR(A), other = CSR(B), and column by column with
+        // driver = CSC(B), other = CSC(A); DriverLeft keeps the factors of every product in the order A*B.
+        // A symbolic phase counts the entries of every outer index, so that the result is allocated exactly
+        // once, then a numeric phase fills it; both split the outer indexes among the threads by flops.
+        template <bool DriverLeft, typename T, typename Index, StorageOrder Order>
+        void spgemm(const CompressedArrays<T, Index, Order>& driver, const CompressedArrays<T, Index, Order>& other, std::size_t outer_size,
+                    std::size_t inner_size, std::size_t threads, std::vector<Index>& result_outer, std::vector<Index>& result_inner,
+                    std::vector<T>& result_values) {
+            // Upper bound of the entries of every outer index (the number of products), prefix-summed
+            std::vector<std::size_t> flops(outer_size + 1, 0);
+            parallel::for_range(outer_size, threads, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t o = begin; o < end; ++o) {
+                    std::size_t f = 0;
+                    for (std::size_t k = driver.outer[o]; k < driver.outer[o + 1]; ++k)
+                        f += other.outer[driver.inner[k] + 1] - other.outer[driver.inner[k]];
+                    flops[o + 1] = f;
+                }
+            });
+            for (std::size_t o = 0; o < outer_size; ++o)
+                flops[o + 1] += flops[o];
+            const std::size_t parts = std::max<std::size_t>(1, std::min({threads, outer_size, flops[outer_size] / 4096 + 1}));
+            const auto bounds = parallel::balanced_partition(flops.data(), outer_size, parts);
+
+            // Symbolic phase: exact number of entries of every outer index
+            std::vector<std::size_t> counts(outer_size + 1, 0);
+            parallel::run(parts, [&](std::size_t t) {
+                SpgemmAccumulator<T, Index> acc(inner_size);
+                for (std::size_t o = bounds[t]; o < bounds[t + 1]; ++o) {
+                    acc.begin_row(flops[o + 1] - flops[o]);
+                    std::size_t count = 0;
+                    for (std::size_t k = driver.outer[o]; k < driver.outer[o + 1]; ++k) {
+                        const std::size_t m = driver.inner[k];
+                        for (std::size_t l = other.outer[m]; l < other.outer[m + 1]; ++l)
+                            count += acc.add(other.inner[l], T(0));
+                    }
+                    acc.end_row();
+                    counts[o + 1] = count;
+                }
+            });
+            for (std::size_t o = 0; o < outer_size; ++o)
+                counts[o + 1] += counts[o];
+            if (counts[outer_size] > static_cast<std::size_t>(std::numeric_limits<Index>::max()))
+                throw std::overflow_error("SparseMatrix: number of non-zeros of the product exceeds the range of the index type");
+            result_outer.assign(counts.begin(), counts.end());
+            result_inner.resize(counts[outer_size]);
+            result_values.resize(counts[outer_size]);
+
+            // Numeric phase: every outer index is written in its own segment, sorted by inner index
+            parallel::run(parts, [&](std::size_t t) {
+                SpgemmAccumulator<T, Index> acc(inner_size);
+                for (std::size_t o = bounds[t]; o < bounds[t + 1]; ++o) {
+                    acc.begin_row(flops[o + 1] - flops[o]);
+                    Index* cols = result_inner.data() + counts[o];
+                    std::size_t w = 0;
+                    for (std::size_t k = driver.outer[o]; k < driver.outer[o + 1]; ++k) {
+                        const std::size_t m = driver.inner[k];
+                        const T d = driver.values[k];
+                        for (std::size_t l = other.outer[m]; l < other.outer[m + 1]; ++l) {
+                            const T v = DriverLeft ? d * other.values[l] : other.values[l] * d;
+                            if (acc.add(other.inner[l], v))
+                                cols[w++] = other.inner[l];
+                        }
+                    }
+                    std::sort(cols, cols + w);
+                    for (std::size_t p = 0; p < w; ++p)
+                        result_values[counts[o] + p] = acc.value(cols[p]);
+                    acc.end_row();
+                }
+            });
+        }
+    }   // namespace detail
+
+    // Sparse matrix-matrix product C = A*B of compressed matrices (any mix of storage orders) with the
+    // result in OrderC, built directly in compressed form. RowMajor results are computed row by row from
+    // the CSR arrays of A and B, ColumnMajor ones column by column from their CSC arrays; operands in the
+    // other order are transposed first. Entries that cancel out are kept as explicit zeros.
+    // Throws std::invalid_argument if the sizes do not match or an operand is not compressed
+    template <StorageOrder OrderC, typename T, StorageOrder OrderA, StorageOrder OrderB, typename Index>
+    SparseMatrix<T, OrderC, Index> multiply(const SparseMatrix<T, OrderA, Index>& A, const SparseMatrix<T, OrderB, Index>& B,
+                                            std::size_t threads) {
+        if (A.get_cols() != B.get_rows())
+            throw std::invalid_argument("SparseMatrix product: sizes do not match (" + std::to_string(A.get_rows()) + "x" +
+                                        std::to_string(A.get_cols()) + " times " + std::to_string(B.get_rows()) + "x" +
+                                        std::to_string(B.get_cols()) + ")");
+        const CompressedArrays<T, Index, OrderC> a(A);
+        const CompressedArrays<T, Index, OrderC> b(B);
+        std::vector<Index> outer, inner;
+        std::vector<T> values;
+        if constexpr (OrderC == StorageOrder::RowMajor)
+            detail::spgemm<true>(a, b, A.get_rows(), B.get_cols(), threads, outer, inner, values);
+        else
+            detail::spgemm<false>(b, a, B.get_cols(), A.get_rows(), threads, outer, inner, values);
+        SparseMatrix<T, OrderC, Index> C;
+        C.assign_compressed(A.get_rows(), B.get_cols(), std::move(outer), std::move(inner), std::move(values));
+        C.set_num_threads(A.get_num_threads());
+        return C;
+    }
+
+    // Sparse matrix-matrix product with the storage order and the number of threads of A
+    template <typename T, StorageOrder OrderA, StorageOrder OrderB, typename Index>
+    SparseMatrix<T, OrderA, Index> operator*(const SparseMatrix<T, OrderA, Index>& A, const SparseMatrix<T, OrderB, Index>& B) {
+        return multiply<OrderA>(A, B, A.get_num_threads());
+    }
+
+    // Transpose of a compressed matrix, in the same storage order
+    template <typename T, StorageOrder Order, typename Index>
+    SparseMatrix<T, Order, Index> transpose(const SparseMatrix<T, Order, Index>& A) {
+        // The arrays of A in the other order are those of A^T in this order
+        constexpr StorageOrder Other = (Order == StorageOrder::RowMajor) ? StorageOrder::ColumnMajor : StorageOrder::RowMajor;
+        const CompressedArrays<T, Index, Other> arrays(A);
+        const std::size_t outer_size = (Order == StorageOrder::RowMajor) ? A.get_cols() : A.get_rows();
+        const std::size_t nnz = A.get_nnz();
+        SparseMatrix<T, Order, Index> At;
+        At.assign_compressed(A.get_cols(), A.get_rows(), std::vector<Index>(arrays.outer, arrays.outer + outer_size + 1),
+                             std::vector<Index>(arrays.inner, arrays.inner + nnz), std::vector<T>(arrays.values, arrays.values + nnz));
+        At.set_num_threads(A.get_num_threads());
+        return At;
+    }
+
+    // Galerkin (triple) product R*A*P, e.g. the coarse operator P^T*A*P of a multigrid level with R = transpose(P),
+    // computed as R*(A*P) without intermediate maps
+    template <typename T, StorageOrder Order, StorageOrder OrderA, StorageOrder OrderP, typename Index>
+    SparseMatrix<T, Order, Index> galerkin_product(const SparseMatrix<T, Order, Index>& R, const SparseMatrix<T, OrderA, Index>& A,
+                                                   const SparseMatrix<T, OrderP, Index>& P, std::size_t threads) {
+        return multiply<Order>(R, multiply<Order>(A, P, threads), threads);
+    }
+
+}   // namespace algebra
+
+#endif  // SPGEMM_HPP
@@ -0,0 +1,594 @@
+#ifndef SPMVKERNELS_HPP
+#define SPMVKERNELS_HPP
+
+#include <algorithm>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Explicit SIMD kernels are available only on x86-64 with GCC/Clang, where they are compiled
+// with per-function target attributes (no -mavx flags needed) and selected at runtime
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SPARSE_SIMD_X86
+#include <immintrin.h>
+#define SPARSE_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define SPARSE_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#endif
+
+namespace algebra::kernels // Compressed matrix-vector product kernels
+{
+    // Instruction sets for which a kernel exists
+    enum class SimdLevel {
+        Scalar,
+        AVX2,
+        AVX512
+    };
+
+    // Best instruction set supported by the CPU
+    inline SimdLevel detect_simd_level() {
+#ifdef SPARSE_SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+            return SimdLevel::AVX512;
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+            return SimdLevel::AVX2;
+#endif
+        return SimdLevel::Scalar;
+    }
+
+    namespace detail {
+        inline SimdLevel& active_level() {
+            static SimdLevel level = detect_simd_level();
+            return level;
+        }
+    }
+
+    // Instruction set used by the kernels
+    inline SimdLevel simd_level() {
+        return detail::active_level();
+    }
+
+    // Forces the kernels to use at most the given instruction set (useful for testing and benchmarking)
+    inline void set_simd_level(SimdLevel level) {
+        const SimdLevel best = detect_simd_level();
+        detail::active_level() = (static_cast<int>(level) < static_cast<int>(best)) ? level : best;
+    }
+
+    namespace detail {
+        // Value and index types for which the SIMD kernels exist
+        template <typename T, typename Index>
+        inline constexpr bool simd_supported =
+            (std::is_same_v<T, double> || std::is_same_v<T, float> || std::is_same_v<T, std::complex<double>>) &&
+            (std::is_same_v<Index, std::size_t> || std::is_same_v<Index, std::uint32_t>);
+
+        // Scalar CSR kernel: y[i] = sum_j values[j]*x[inner[j]] for the rows in [begin, end)
+        template <typename T, typename Index>
+        void csr_scalar(const T* values, const Index* outer, const Index* inner, const T* x, T* y, std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                T sum = 0;
+                for (std::size_t j = outer[i]; j < outer[i + 1]; ++j) {
+                    sum += values[j] * x[inner[j]];
+                }
+                y[i] = sum;
+            }
+        }
+
+        // Scalar CSC kernel: y[inner[j]] += values[j]*alpha*x[i] for the columns in [begin, end)
+        template <typename T, typename Index>
+        void csc_scalar(const T* values, const Index* outer, const Index* inner, const T* x, T* y, std::size_t begin, std::size_t end, T alpha) {
+            for (std::size_t i = begin; i < end; ++i) {
+                const T xi = alpha * x[i];
+                for (std::size_t j = outer[i]; j < outer[i + 1]; ++j) {
+                    y[inner[j]] += values[j] * xi;
+                }
+            }
+        }
+
+#ifdef SPARSE_SIMD_X86
+        // Loading of the indexes of x: 32-bit indexes are zero-extended to 64 bits, so that the
+        // gathers are correct for any unsigned index (the saving is in memory traffic anyway)
+        SPARSE_TARGET_AVX2 inline __m256i load_index4(const std::size_t* c) {
+            return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c));
+        }
+
+        SPARSE_TARGET_AVX2 inline __m256i load_index4(const std::uint32_t* c) {
+            return _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(c)));
+        }
+
+        SPARSE_TARGET_AVX512 inline __m512i load_index8(const std::size_t* c) {
+            return _mm512_loadu_si512(c);
+        }
+
+        SPARSE_TARGET_AVX512 inline __m512i load_index8(const std::uint32_t* c) {
+            return _mm512_cvtepu32_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(c)));
+        }
+
+        SPARSE_TARGET_AVX512 inline __m512i load_index8(const std::size_t* c, __mmask8 m) {
+            return _mm512_maskz_loadu_epi64(m, c);
+        }
+
+        SPARSE_TARGET_AVX512 inline __m512i load_index8(const std::uint32_t* c, __mmask8 m) {
+            return _mm512_cvtepu32_epi64(_mm512_castsi512_si256(_mm512_maskz_loadu_epi32(static_cast<__mmask16>(m), c)));
+        }
+
+        // ---------------------------------------------------------------- AVX2
+        // Row dot products: two accumulators of 4 (8 for float) lanes hide the FMA latency,
+        // x is loaded with hardware gathers
+
+        SPARSE_TARGET_AVX2 inline double hsum_avx2(__m256d v) {
+            __m128d lo = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+            return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+        }
+
+        SPARSE_TARGET_AVX2 inline float hsum_avx2(__m256 v) {
+            __m128 lo = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+            lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+            return _mm_cvtss_f32(_mm_add_ss(lo, _mm_movehdup_ps(lo)));
+        }
+
+        template <typename Index>
+        SPARSE_TARGET_AVX2 inline double row_dot_avx2(const double* v, const Index* c, const double* x, std::size_t n) {
+            __m256d acc0 = _mm256_setzero_pd();
+            __m256d acc1 = _mm256_setzero_pd();
+            std::size_t k = 0;
+            for (; k + 8 <= n; k += 8) {
+                const __m256i i0 = load_index4(c + k);
+                const __m256i i1 = load_index4(c + k + 4);
+                acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(v + k), _mm256_i64gather_pd(x, i0, 8), acc0);
+                acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(v + k + 4), _mm256_i64gather_pd(x, i1, 8), acc1);
+            }
+            if (k + 4 <= n) {
+                const __m256i i0 = load_index4(c + k);
+                acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(v + k), _mm256_i64gather_pd(x, i0, 8), acc0);
+                k += 4;
+            }
+            double sum = hsum_avx2(_mm256_add_pd(acc0, acc1));
+            for (; k < n; ++k)
+                sum += v[k] * x[c[k]];
+            return sum;
+        }
+
+        template <typename Index>
+        SPARSE_TARGET_AVX2 inline float row_dot_avx2(const float* v, const Index* c, const float* x, std::size_t n) {
+            __m256 acc0 = _mm256_setzero_ps();
+            __m256 acc1 = _mm256_setzero_ps();
+            std::size_t k = 0;
+            for (; k + 16 <= n; k += 16) {
+                const __m128 g0 = _mm256_i64gather_ps(x, load_index4(c + k), 4);
+                const __m128 g1 = _mm256_i64gather_ps(x, load_index4(c + k + 4), 4);
+                const __m128 g2 = _mm256_i64gather_ps(x, load_index4(c + k + 8), 4);
+                const __m128 g3 = _mm256_i64gather_ps(x, load_index4(c + k + 12), 4);
+                acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(v + k), _mm256_set_m128(g1, g0), acc0);
+                acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(v + k + 8), _mm256_set_m128(g3, g2), acc1);
+            }
+            if (k + 8 <= n) {
+                const __m128 g0 = _mm256_i64gather_ps(x, load_index4(c + k), 4);
+                const __m128 g1 = _mm256_i64gather_ps(x, load_index4(c + k + 4), 4);
+                acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(v + k), _mm256_set_m128(g1, g0), acc0);
+                k += 8;
+            }
+            float sum = hsum_avx2(_mm256_add_ps(acc0, acc1));
+            for (; k < n; ++k)
+                sum += v[k] * x[c[k]];
+            return sum;
+        }
+
+        // Complex values are stored as (re, im) pairs: a += v*x collects (vr*xr, vi*xi) and
+        // b += v*swap(x) collects (vr*xi, vi*xr), so the loop has no shuffles besides the swap
+        template <typename Index>
+        SPARSE_TARGET_AVX2 inline std::complex<double> row_dot_avx2(const std::complex<double>* v, const Index* c,
+                                                                    const std::complex<double>* x, std::size_t n) {
+            const double* vd = reinterpret_cast<const double*>(v);
+            const double* xd = reinterpret_cast<const double*>(x);
+            __m256d a0 = _mm256_setzero_pd(), b0 = _mm256_setzero_pd();
+            __m256d a1 = _mm256_setzero_pd(), b1 = _mm256_setzero_pd();
+            std::size_t k = 0;
+            for (; k + 4 <= n; k += 4) {
+                const __m256d x0 = _mm256_set_m128d(_mm_loadu_pd(xd + 2 * c[k + 1]), _mm_loadu_pd(xd + 2 * c[k]));
+                const __m256d x1 = _mm256_set_m128d(_mm_loadu_pd(xd + 2 * c[k + 3]), _mm_loadu_pd(xd + 2 * c[k + 2]));
+                const __m256d v0 = _mm256_loadu_pd(vd + 2 * k);
+                const __m256d v1 = _mm256_loadu_pd(vd + 2 * k + 4);
+                a0 = _mm256_fmadd_pd(v0, x0, a0);
+                b0 = _mm256_fmadd_pd(v0, _mm256_permute_pd(x0, 0b0101), b0);
+                a1 = _mm256_fmadd_pd(v1, x1, a1);
+                b1 = _mm256_fmadd_pd(v1, _mm256_permute_pd(x1, 0b0101), b1);
+            }
+            alignas(32) double a[4], b[4];
+            _mm256_store_pd(a, _mm256_add_pd(a0, a1));
+            _mm256_store_pd(b, _mm256_add_pd(b0, b1));
+            double re = (a[0] - a[1]) + (a[2] - a[3]);
+            double im = (b[0] + b[1]) + (b[2] + b[3]);
+            for (; k < n; ++k) {
+                const double vr = vd[2 * k], vi = vd[2 * k + 1];
+                const double xr = xd[2 * c[k]], xi = xd[2 * c[k] + 1];
+                re += vr * xr - vi * xi;
+                im += vr * xi + vi * xr;
+            }
+            return {re, im};
+        }
+
+        template <typename T, typename Index>
+        SPARSE_TARGET_AVX2 void csr_avx2(const T* values, const Index* outer, const Index* inner, const T* x, T* y, std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                const std::size_t first = outer[i];
+                y[i] = row_dot_avx2(values + first, inner + first, x, outer[i + 1] - first);
+            }
+        }
+
+        // -------------------------------------------------------------- AVX512
+        // Same scheme with 8 (16 for float) lanes; the tail of a row uses masked gathers,
+        // which matters for short rows
+
+        template <typename Index>
+        SPARSE_TARGET_AVX512 inline double row_dot_avx512(const double* v, const Index* c, const double* x, std::size_t n) {
+            __m512d acc0 = _mm512_setzero_pd();
+            __m512d acc1 = _mm512_setzero_pd();
+            std::size_t k = 0;
+            for (; k + 16 <= n; k += 16) {
+                const __m512i i0 = load_index8(c + k);
+                const __m512i i1 = load_index8(c + k + 8);
+                acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(v + k), _mm512_i64gather_pd(i0, x, 8), acc0);
+                acc1 = _mm512_fmadd_pd(_mm512_loadu_pd(v + k + 8), _mm512_i64gather_pd(i1, x, 8), acc1);
+            }
+            if (k + 8 <= n) {
+                const __m512i i0 = load_index8(c + k);
+                acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(v + k), _mm512_i64gather_pd(i0, x, 8), acc0);
+                k += 8;
+            }
+            if (k < n) {
+                const __mmask8 m = static_cast<__mmask8>((1u << (n - k)) - 1);
+                const __m512i i0 = load_index8(c + k, m);
+                const __m512d g = _mm512_mask_i64gather_pd(_mm512_setzero_pd(), m, i0, x, 8);
+                acc1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, v + k), g, acc1);
+            }
+            return _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+        }
+
+        template <typename Index>
+        SPARSE_TARGET_AVX512 inline float row_dot_avx512(const float* v, const Index* c, const float* x, std::size_t n) {
+            // 64-bit indexes gather 8 floats at a time
+            __m256 acc0 = _mm256_setzero_ps();
+            __m256 acc1 = _mm256_setzero_ps();
+            std::size_t k = 0;
+            for (; k + 16 <= n; k += 16) {
+                const __m256 g0 = _mm512_i64gather_ps(load_index8(c + k), x, 4);
+                const __m256 g1 = _mm512_i64gather_ps(load_index8(c + k + 8), x, 4);
+                acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(v + k), g0, acc0);
+                acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(v + k + 8), g1, acc1);
+            }
+            if (k + 8 <= n) {
+                const __m256 g0 = _mm512_i64gather_ps(load_index8(c + k), x, 4);
+                acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(v + k), g0, acc0);
+                k += 8;
+            }
+            float sum = hsum_avx2(_mm256_add_ps(acc0, acc1));
+            for (; k < n; ++k)
+                sum += v[k] * x[c[k]];
+            return sum;
+        }
+
+        // Complex x entries are 16 bytes wide and are loaded in pairs anyway: the 512-bit version
+        // measured slower than the 256-bit one, so the AVX2 kernel is used
+        template <typename Index>
+        SPARSE_TARGET_AVX512 inline std::complex<double> row_dot_avx512(const std::complex<double>* v, const Index* c,
+                                                                        const std::complex<double>* x, std::size_t n) {
+            return row_dot_avx2(v, c, x, n);
+        }
+
+        template <typename T, typename Index>
+        SPARSE_TARGET_AVX512 void csr_avx512(const T* values, const Index* outer, const Index* inner, const T* x, T* y, std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                const std::size_t first = outer[i];
+                y[i] = row_dot_avx512(values + first, inner + first, x, outer[i + 1] - first);
+            }
+        }
+#endif
+    }   // namespace detail
+
+    // CSR product y[i] = (A*x)[i] for the rows i in [begin, end)
+    template <typename T, typename Index>
+    void csr_multiply(const T* values, const Index* outer, const Index* inner, const T* x, T* y, std::size_t begin, std::size_t end) {
+#ifdef SPARSE_SIMD_X86
+        if constexpr (detail::simd_supported<T, Index>) {
+            switch (simd_level()) {
+            case SimdLevel::AVX512:
+                return detail::csr_avx512(values, outer, inner, x, y, begin, end);
+            case SimdLevel::AVX2:
+                return detail::csr_avx2(values, outer, inner, x, y, begin, end);
+            default:
+                break;
+            }
+        }
+#endif
+        detail::csr_scalar(values, outer, inner, x, y, begin, end);
+    }
+
+    // CSC product y += alpha*A(:, begin:end)*x(begin:end). The update of y is a scatter: gather/scatter
+    // SIMD versions measured slower than this loop, so it stays scalar
+    template <typename T, typename Index>
+    void csc_multiply(const T* values, const Index* outer, const Index* inner, const T* x, T* y, std::size_t begin, std::size_t end, T alpha = T(1)) {
+        detail::csc_scalar(values, outer, inner, x, y, begin, end, alpha);
+    }
+
+    namespace detail {
+        // Block CSR kernel with k fixed at compile time: the K accumulators of a row stay in registers
+        // and every row of X (K contiguous values) is loaded once per non-zero
+        template <std::size_t K, typename T, typename Index>
+        void csr_block_fixed(const T* values, const Index* outer, const Index* inner, const T* x, T* y, std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                T acc[K] = {};
+                for (std::size_t j = outer[i]; j < outer[i + 1]; ++j) {
+                    const T v = values[j];
+                    const T* xr = x + static_cast<std::size_t>(inner[j]) * K;
+                    for (std::size_t c = 0; c < K; ++c)
+                        acc[c] += v * xr[c];
+                }
+                for (std::size_t c = 0; c < K; ++c)
+                    y[i * K + c] = acc[c];
+            }
+        }
+
+        template <typename T, typename Index>
+        void csr_block_generic(const T* values, const Index* outer, const Index* inner, const T* x, T* y, std::size_t k, std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                T* yr = y + i * k;
+                std::fill(yr, yr + k, T(0));
+                for (std::size_t j = outer[i]; j < outer[i + 1]; ++j) {
+                    const T v = values[j];
+                    const T* xr = x + static_cast<std::size_t>(inner[j]) * k;
+                    for (std::size_t c = 0; c < k; ++c)
+                        yr[c] += v * xr[c];
+                }
+            }
+        }
+
+        // Block CSC kernel with k fixed at compile time: one row of X is kept in registers for a whole column
+        template <std::size_t K, typename T, typename Index>
+        void csc_block_fixed(const T* values, const Index* outer, const Index* inner, const T* x, T* y, std::size_t begin, std::size_t end, T alpha) {
+            for (std::size_t i = begin; i < end; ++i) {
+                T xr[K];
+                for (std::size_t c = 0; c < K; ++c)
+                    xr[c] = alpha * x[i * K + c];
+                for (std::size_t j = outer[i]; j < outer[i + 1]; ++j) {
+                    const T v = values[j];
+                    T* yr = y + static_cast<std::size_t>(inner[j]) * K;
+                    for (std::size_t c = 0; c < K; ++c)
+                        yr[c] += v * xr[c];
+                }
+            }
+        }
+
+        template <typename T, typename Index>
+        void csc_block_generic(const T* values, const Index* outer, const Index* inner, const T* x, T* y, std::size_t k, std::size_t begin, std::size_t end, T alpha) {
+            for (std::size_t i = begin; i < end; ++i) {
+                const T* xr = x + i * k;
+                for (std::size_t j = outer[i]; j < outer[i + 1]; ++j) {
+                    const T v = alpha * values[j];
+                    T* yr = y + static_cast<std::size_t>(inner[j]) * k;
+                    for (std::size_t c = 0; c < k; ++c)
+                        yr[c] += v * xr[c];
+                }
+            }
+        }
+    }   // namespace detail
+
+    // CSR product with k right-hand sides stored row-major (X is cols x k, Y is rows x k):
+    // Y(i, :) = A(i, :)*X for the rows i in [begin, end)
+    template <typename T, typename Index>
+    void csr_multiply_block(const T* values, const Index* outer, const Index* inner, const T* x, T* y, std::size_t k, std::size_t begin, std::size_t end) {
+        switch (k) {
+        case 1:
+            return csr_multiply(values, outer, inner, x, y, begin, end);
+        case 2:
+            return detail::csr_block_fixed<2>(values, outer, inner, x, y, begin, end);
+        case 4:
+            return detail::csr_block_fixed<4>(values, outer, inner, x, y, begin, end);
+        case 8:
+            return detail::csr_block_fixed<8>(values, outer, inner, x, y, begin, end);
+        default:
+            return detail::csr_block_generic(values, outer, inner, x, y, k, begin, end);
+        }
+    }
+
+    // CSC product with k right-hand sides stored row-major: Y += alpha*A(:, begin:end)*X(begin:end, :)
+    template <typename T, typename Index>
+    void csc_multiply_block(const T* values, const Index* outer, const Index* inner, const T* x, T* y, std::size_t k, std::size_t begin, std::size_t end, T alpha = T(1)) {
+        switch (k) {
+        case 1:
+            return csc_multiply(values, outer, inner, x, y, begin, end, alpha);
+        case 2:
+            return detail::csc_block_fixed<2>(values, outer, inner, x, y, begin, end, alpha);
+        case 4:
+            return detail::csc_block_fixed<4>(values, outer, inner, x, y, begin, end, alpha);
+        case 8:
+            return detail::csc_block_fixed<8>(values, outer, inner, x, y, begin, end, alpha);
+        default:
+            return detail::csc_block_generic(values, outer, inner, x, y, k, begin, end, alpha);
+        }
+    }
+
+    // ---------------------------------------------------------------- SELL-C-sigma
+    // Sliced ELLPACK layout: rows are grouped in chunks of C, every chunk is padded to its longest row
+    // and stored column by column, so that entry j of the C rows of chunk c is contiguous at
+    // chunk_ptr[c] + j*C. row_of maps the (sorted) position of a row to the original row index
+
+    // Largest chunk height supported by the kernels
+    inline constexpr std::size_t sell_max_chunk = 64;
+
+    namespace detail {
+        template <typename T, typename Index>
+        void sell_scalar(const T* values, const Index* cols, const std::size_t* chunk_ptr, std::size_t C, const Index* row_of,
+                         std::size_t rows, const T* x, T* y, std::size_t begin, std::size_t end) {
+            T acc[sell_max_chunk];
+            for (std::size_t c = begin; c < end; ++c) {
+                const std::size_t off = chunk_ptr[c];
+                const std::size_t width = (chunk_ptr[c + 1] - off) / C;
+                std::fill(acc, acc + C, T(0));
+                for (std::size_t j = 0; j < width; ++j) {
+                    const T* v = values + off + j * C;
+                    const Index* col = cols + off + j * C;
+                    for (std::size_t r = 0; r < C; ++r)
+                        acc[r] += v[r] * x[col[r]];
+                }
+                const std::size_t last = std::min(C, rows - c * C);
+                for (std::size_t r = 0; r < last; ++r)
+                    y[row_of[c * C + r]] = acc[r];
+            }
+        }
+
+#ifdef SPARSE_SIMD_X86
+        // G accumulators of 4 rows each for the rows [g, g + 4G) of a chunk: one load of the values
+        // and one gather of x per accumulator and column, with no horizontal sums
+        template <int G, typename Index>
+        SPARSE_TARGET_AVX2 inline void sell_group_avx2(const double* values, const Index* cols, std::size_t C, std::size_t width,
+                                                       const double* x, double* acc) {
+            __m256d a[G];
+            for (int k = 0; k < G; ++k)
+                a[k] = _mm256_setzero_pd();
+            for (std::size_t j = 0; j < width; ++j) {
+                const double* v = values + j * C;
+                const Index* col = cols + j * C;
+                for (int k = 0; k < G; ++k)
+                    a[k] = _mm256_fmadd_pd(_mm256_loadu_pd(v + 4 * k), _mm256_i64gather_pd(x, load_index4(col + 4 * k), 8), a[k]);
+            }
+            for (int k = 0; k < G; ++k)
+                _mm256_storeu_pd(acc + 4 * k, a[k]);
+        }
+
+        template <int G, typename Index>
+        SPARSE_TARGET_AVX2 inline void sell_group_avx2(const float* values, const Index* cols, std::size_t C, std::size_t width,
+                                                       const float* x, float* acc) {
+            // 64-bit indexes gather 4 floats at a time: two gathers per accumulator of 8 rows
+            __m256 a[G];
+            for (int k = 0; k < G; ++k)
+                a[k] = _mm256_setzero_ps();
+            for (std::size_t j = 0; j < width; ++j) {
+                const float* v = values + j * C;
+                const Index* col = cols + j * C;
+                for (int k = 0; k < G; ++k) {
+                    const __m128 g0 = _mm256_i64gather_ps(x, load_index4(col + 8 * k), 4);
+                    const __m128 g1 = _mm256_i64gather_ps(x, load_index4(col + 8 * k + 4), 4);
+                    a[k] = _mm256_fmadd_ps(_mm256_loadu_ps(v + 8 * k), _mm256_set_m128(g1, g0), a[k]);
+                }
+            }
+            for (int k = 0; k < G; ++k)
+                _mm256_storeu_ps(acc + 8 * k, a[k]);
+        }
+
+        // AVX2 SELL kernel, C multiple of the lanes (4 doubles, 8 floats): rows are processed in groups
+        // of up to 4 registers, so that the accumulators of a chunk stay in registers
+        template <typename T, typename Index>
+        SPARSE_TARGET_AVX2 void sell_avx2(const T* values, const Index* cols, const std::size_t* chunk_ptr, std::size_t C, const Index* row_of,
+                                          std::size_t rows, const T* x, T* y, std::size_t begin, std::size_t end) {
+            constexpr std::size_t lanes = 32 / sizeof(T);
+            alignas(64) T acc[sell_max_chunk];
+            for (std::size_t c = begin; c < end; ++c) {
+                const std::size_t off = chunk_ptr[c];
+                const std::size_t width = (chunk_ptr[c + 1] - off) / C;
+                for (std::size_t g = 0; g < C; g += 4 * lanes) {
+                    const T* v = values + off + g;
+                    const Index* col = cols + off + g;
+                    switch (std::min(C - g, 4 * lanes) / lanes) {
+                    case 1:
+                        sell_group_avx2<1>(v, col, C, width, x, acc + g);
+                        break;
+                    case 2:
+                        sell_group_avx2<2>(v, col, C, width, x, acc + g);
+                        break;
+                    case 3:
+                        sell_group_avx2<3>(v, col, C, width, x, acc + g);
+                        break;
+                    default:
+                        sell_group_avx2<4>(v, col, C, width, x, acc + g);
+                        break;
+                    }
+                }
+                const std::size_t last = std::min(C, rows - c * C);
+                for (std::size_t r = 0; r < last; ++r)
+                    y[row_of[c * C + r]] = acc[r];
+            }
+        }
+
+        template <int G, typename Index>
+        SPARSE_TARGET_AVX512 inline void sell_group_avx512(const double* values, const Index* cols, std::size_t C, std::size_t width,
+                                                           const double* x, double* acc) {
+            __m512d a[G];
+            for (int k = 0; k < G; ++k)
+                a[k] = _mm512_setzero_pd();
+            for (std::size_t j = 0; j < width; ++j) {
+                const double* v = values + j * C;
+                const Index* col = cols + j * C;
+                for (int k = 0; k < G; ++k)
+                    a[k] = _mm512_fmadd_pd(_mm512_loadu_pd(v + 8 * k), _mm512_i64gather_pd(load_index8(col + 8 * k), x, 8), a[k]);
+            }
+            for (int k = 0; k < G; ++k)
+                _mm512_storeu_pd(acc + 8 * k, a[k]);
+        }
+
+        // AVX-512 SELL kernel for doubles, C multiple of 8
+        template <typename Index>
+        SPARSE_TARGET_AVX512 void sell_avx512(const double* values, const Index* cols, const std::size_t* chunk_ptr, std::size_t C, const Index* row_of,
+                                              std::size_t rows, const double* x, double* y, std::size_t begin, std::size_t end) {
+            alignas(64) double acc[sell_max_chunk];
+            for (std::size_t c = begin; c < end; ++c) {
+                const std::size_t off = chunk_ptr[c];
+                const std::size_t width = (chunk_ptr[c + 1] - off) / C;
+                for (std::size_t g = 0; g < C; g += 32) {
+                    const double* v = values + off + g;
+                    const Index* col = cols + off + g;
+                    switch (std::min<std::size_t>(C - g, 32) / 8) {
+                    case 1:
+                        sell_group_avx512<1>(v, col, C, width, x, acc + g);
+                        break;
+                    case 2:
+                        sell_group_avx512<2>(v, col, C, width, x, acc + g);
+                        break;
+                    case 3:
+                        sell_group_avx512<3>(v, col, C, width, x, acc + g);
+                        break;
+                    default:
+                        sell_group_avx512<4>(v, col, C, width, x, acc + g);
+                        break;
+                    }
+                }
+                const std::size_t last = std::min(C, rows - c * C);
+                for (std::size_t r = 0; r < last; ++r)
+                    y[row_of[c * C + r]] = acc[r];
+            }
+        }
+#endif
+    }   // namespace detail
+
+    // SELL-C-sigma product for the chunks [begin, end): y[row_of[p]] = (A*x) of the row in position p.
+    // C must be at most sell_max_chunk; the SIMD versions need C to be a multiple of the vector lanes
+    template <typename T, typename Index>
+    void sell_multiply(const T* values, const Index* cols, const std::size_t* chunk_ptr, std::size_t C, const Index* row_of,
+                       std::size_t rows, const T* x, T* y, std::size_t begin, std::size_t end) {
+#ifdef SPARSE_SIMD_X86
+        if constexpr ((std::is_same_v<T, double> || std::is_same_v<T, float>) &&
+                      (std::is_same_v<Index, std::size_t> || std::is_same_v<Index, std::uint32_t>)) {
+            const SimdLevel level = simd_level();
+            if constexpr (std::is_same_v<T, double>) {
+                if (level == SimdLevel::AVX512 && C % 8 == 0)
+                    return detail::sell_avx512(values, cols, chunk_ptr, C, row_of, rows, x, y, begin, end);
+            }
+            if (level != SimdLevel::Scalar && C % (32 / sizeof(T)) == 0)
+                return detail::sell_avx2(values, cols, chunk_ptr, C, row_of, rows, x, y, begin, end);
+        }
+#endif
+        detail::sell_scalar(values, cols, chunk_ptr, C, row_of, rows, x, y, begin, end);
+    }
+
+    // Conjugate of complex values and identity for the others, for the inner products conj(x)*y
+    template <typename T>
+    T conj(const T& v) {
+        if constexpr (std::is_same_v<T, std::complex<float>> || std::is_same_v<T, std::complex<double>> || std::is_same_v<T, std::complex<long double>>)
+            return std::conj(v);
+        else
+            return v;
+    }
+
+}   // namespace algebra::kernels
+
+#endif  // SPMVKERNELS_HPP
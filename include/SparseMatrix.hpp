@@ -6,10 +6,25 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 #include <array>
 #include <complex>
 #include <fstream>
 #include <sstream>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <cstring>
+#include <iterator>
+#include <span>
+
+#include "BinaryFormat.hpp"
+#include "Instrumentation.hpp"
+#include "MappedFile.hpp"
+#include "MatrixMarket.hpp"
+#include "Parallel.hpp"
+#include "SpMVKernels.hpp"
 
 enum class StorageOrder {
     RowMajor,
@@ -43,8 +58,46 @@ struct MyComparator<StorageOrder::ColumnMajor>{
 
 namespace algebra // Algebra namespace
 {
-    template <typename T,StorageOrder Order>
+    // Precomputed scatter of a list of contributions into the slots of a frozen pattern (see
+    // SparseMatrix::make_scatter_plan): the contributions are sorted by slot, so that threads can
+    // accumulate disjoint ranges of slots without conflicts
+    struct ScatterPlan {
+        std::vector<std::size_t> order;         // contribution indexes sorted by slot (stable)
+        std::vector<std::size_t> slots;         // slot of each contribution, in the same order
+    };
+
+    // Zero-copy view of one row (RowMajor) or column (ColumnMajor) of a compressed matrix: the sorted column
+    // (row) indexes of its non-zeros and their values, in place in the compressed vectors. V is const T for
+    // read-only views. Valid while the pattern of the matrix is unchanged
+    template <typename V, typename Index>
+    struct SparseVectorView {
+        std::span<const Index> indexes;
+        std::span<V> values;
+
+        std::size_t size() const {
+            return indexes.size();
+        }
+
+        // Position of index j in the view (binary search), or size() if it is not a non-zero
+        std::size_t find(std::size_t j) const {
+            const auto it = std::lower_bound(indexes.begin(), indexes.end(), static_cast<Index>(j));
+            return (it != indexes.end() && *it == j) ? static_cast<std::size_t>(it - indexes.begin()) : size();
+        }
+    };
+
+    // Non-zero element returned by the iterators of SparseMatrix
+    template <typename T>
+    struct MatrixEntry {
+        std::size_t row;
+        std::size_t col;
+        T value;
+    };
+
+    // Index is the integer type of the compressed index vectors: 32-bit indexes (std::uint32_t) can be used
+    // for matrices with less than 4G rows, columns and non-zeros, saving memory and bandwidth
+    template <typename T,StorageOrder Order,typename Index = std::size_t>
     class SparseMatrix{
+        static_assert(std::is_integral_v<Index> && std::is_unsigned_v<Index>, "Index must be an unsigned integer type");
     private:
         // Type definitions
         using IndexArray = std::array<std::size_t, 2>;
@@ -57,9 +110,123 @@ namespace algebra // Algebra namespace
         std::size_t num_cols;
         
         // vectors for the Compressed Sparse Row/Column (COMPRESSED TECHNIQUE)
-        std::vector<std::size_t> first_indexes;
-        std::vector<std::size_t> second_indexes;
+        std::vector<Index> first_indexes;
+        std::vector<Index> second_indexes;
         std::vector<T> values;
+
+        // Memory mapping of a binary file holding the compressed vectors (see load_binary). When it is set the
+        // three vectors above are empty and the data is read in place from the file (zero-copy). The mapping is
+        // read-only and shared among copies of the matrix: any change to the data first detaches it.
+        std::shared_ptr<const MappedFile> mapping;
+        const Index* mapped_first = nullptr;
+        const Index* mapped_second = nullptr;
+        const T* mapped_values = nullptr;
+        std::size_t mapped_nnz = 0;
+
+        // Read access to the compressed vectors, wherever they are stored
+        const Index* first_ptr() const { return mapping ? mapped_first : first_indexes.data(); }
+        const Index* second_ptr() const { return mapping ? mapped_second : second_indexes.data(); }
+        const T* values_ptr() const { return mapping ? mapped_values : values.data(); }
+        std::size_t nnz() const { return mapping ? mapped_nnz : values.size(); }
+
+        // Copies the memory-mapped compressed vectors into the owned ones
+        void detach();
+
+        // Side buffer of the elements inserted in compressed state (see finalize): they are taken into account
+        // by the call operators and by operator* until they are merged into the compressed vectors
+        MapType pending;
+
+        // True if the pattern of the compressed matrix cannot change (see freeze_pattern)
+        bool frozen = false;
+
+        // Triplet buffer of the assembly mode (see add): contributions are appended here and only sorted and
+        // merged, together with the map, by compress()
+        std::vector<std::size_t> triplet_rows;
+        std::vector<std::size_t> triplet_cols;
+        std::vector<T> triplet_values;
+
+        // Empties the triplet buffer releasing its memory
+        void clear_triplets() {
+            std::vector<std::size_t>().swap(triplet_rows);
+            std::vector<std::size_t>().swap(triplet_cols);
+            std::vector<T>().swap(triplet_values);
+        }
+
+        // Number of threads used by the compressed matrix-vector product
+        std::size_t num_threads = 1;
+
+        // Replaces the content of the coordinate map with the given entries
+        void assign_triplets(const mm::Triplets<T>& triplets);
+
+        // Sorts the entries [0, n) of one row (column) by second index
+        static void sort_segment(Index* idx, T* val, std::size_t n);
+
+        // View of row (column) o of the compressed vectors
+        SparseVectorView<const T, Index> outer_view(std::size_t o) const {
+            if (!compressed)
+                throw std::logic_error("SparseMatrix: row and column views exist only in compressed state");
+            if (o >= outer_size())
+                throw std::out_of_range("Index out of range");
+            const Index* first = first_ptr();
+            const std::size_t n = first[o + 1] - first[o];
+            return {std::span<const Index>(second_ptr() + first[o], n), std::span<const T>(values_ptr() + first[o], n)};
+        }
+
+        SparseVectorView<T, Index> mutable_outer_view(std::size_t o) {
+            detach();
+            const SparseVectorView<const T, Index> view = outer_view(o);
+            const std::size_t start = first_indexes[o];
+            return {view.indexes, std::span<T>(values.data() + start, view.size())};
+        }
+
+        // Position of A_{i,j} in the compressed vectors (binary search in the sorted row/column), or nnz() if
+        // it is not there
+        std::size_t find_compressed(std::size_t i, std::size_t j) const {
+            const std::size_t outer = (Order == StorageOrder::RowMajor) ? i : j;
+            const std::size_t inner = (Order == StorageOrder::RowMajor) ? j : i;
+            const Index* first = first_ptr();
+            const Index* second = second_ptr();
+            const Index* begin = second + first[outer];
+            const Index* end = second + first[outer + 1];
+            const Index* it = std::lower_bound(begin, end, static_cast<Index>(inner));
+            return (it != end && *it == inner) ? static_cast<std::size_t>(it - second) : nnz();
+        }
+
+        // Throws if n cannot be stored in the Index type
+        static void check_index_range(std::size_t n, const char* what) {
+            if (n > static_cast<std::size_t>(std::numeric_limits<Index>::max()))
+                throw std::overflow_error(std::string("SparseMatrix: ") + what + " exceeds the range of the index type");
+        }
+
+        // Number of rows (RowMajor) or columns (ColumnMajor) of the compressed vectors, and the other dimension
+        std::size_t outer_size() const { return Order == StorageOrder::RowMajor ? num_rows : num_cols; }
+        std::size_t inner_size() const { return Order == StorageOrder::RowMajor ? num_cols : num_rows; }
+
+        // Throws std::invalid_argument if y and x do not fit the product with M (or its transpose)
+        void check_product_sizes(std::size_t y_size, std::size_t x_size, bool transpose) const;
+
+        // y = alpha*op(M)*x + beta*y with op(M) = M or its transpose, for all the storage formats.
+        // With dot, returns conj(x)*y of the new y (square matrices only)
+        T product_into(T* y, const T* x, T alpha, T beta, bool transpose, std::size_t threads, bool dot) const;
+
+        // y = alpha*S*x + beta*y where the rows of S are the outer indexes of the compressed vectors
+        // (M for CSR, M^T for CSC); the update of y and the dot product are fused with the product
+        T gather_into(T* y, const T* x, T alpha, T beta, std::size_t threads, bool dot) const;
+
+        // Compressed product Y = M*X, X and Y with k columns stored row-major (k = 1 for a vector)
+        void multiply_compressed(const T* x, T* y, std::size_t k, std::size_t threads) const;
+
+        // Y += alpha*S^T*X where the rows of S are the outer indexes of the compressed vectors
+        // (M for CSC, M^T for CSR): every outer index scatters into the rows of Y
+        void scatter_product(const T* x, T* y, std::size_t k, T alpha, std::size_t threads) const;
+
+        // Parallel scatter product: every thread scatters into a private copy of the result,
+        // then the copies are summed up row-block by row-block
+        void scatter_privatized(const T* x, T* y, std::size_t k, T alpha, std::size_t threads) const;
+
+        // Parallel scatter product: every thread owns a block of rows of Y and, in every outer index,
+        // binary searches the first entry of its block (inner indexes are sorted)
+        void scatter_row_blocked(const T* x, T* y, std::size_t k, T alpha, std::size_t threads) const;
     public:
         // Constructors
         SparseMatrix() : num_rows(0), num_cols(0), compressed(false) {}                                        // Default Constructor  
@@ -76,12 +243,115 @@ namespace algebra // Algebra namespace
         // Method to resize the Sparse Matrix
         void resize(std::size_t rows, std::size_t cols);
 
+        // Method to add a contribution to A_{i,j} in assembly mode: the contribution is appended to a contiguous
+        // triplet buffer (no map node) and duplicated entries are summed up by compress(). Contributions are not
+        // visible through the call operators or operator* until the matrix is compressed
+        void add(std::size_t i, std::size_t j, const T& value) {
+            if (compressed)
+                throw std::logic_error("SparseMatrix: add() needs an uncompressed matrix");
+            if (i >= num_rows || j >= num_cols)
+                throw std::out_of_range("Index out of range");
+            triplet_rows.push_back(i);
+            triplet_cols.push_back(j);
+            triplet_values.push_back(value);
+        }
+
+        // Method to reserve space in the triplet buffer for n contributions
+        void reserve(std::size_t n) {
+            triplet_rows.reserve(n);
+            triplet_cols.reserve(n);
+            triplet_values.reserve(n);
+        }
+
         // Method to compress the Sparse Matrix
         void compress();
 
         // Method to uncompress the matrix
         void uncompress();
 
+        // Method to build the compressed matrix directly from (row, col, value) triplets (0-based),
+        // without going through the map: counting sort by row (column), then sort and merge of the
+        // duplicates (summed up) inside each row (column). The input does not need to be sorted.
+        void compress_from_triplets(std::size_t rows, std::size_t cols, const std::vector<std::size_t>& row_indexes,
+                                    const std::vector<std::size_t>& col_indexes, const std::vector<T>& vals);
+
+        // Method to take over compressed vectors built elsewhere (e.g. by a sparse matrix product): outer has
+        // rows+1 (RowMajor) or cols+1 (ColumnMajor) entries, and the inner indexes are sorted and unique inside
+        // every row (column). Throws std::invalid_argument if the vectors are not a valid compressed matrix
+        void assign_compressed(std::size_t rows, std::size_t cols, std::vector<Index>&& outer, std::vector<Index>&& inner,
+                               std::vector<T>&& vals);
+
+        // Method to save the compressed matrix in a versioned binary file (the matrix is compressed in a copy if needed)
+        void save_binary(const std::string& filename) const;
+
+        // Method to load a matrix saved by save_binary: the file is memory-mapped and the compressed vectors are
+        // used in place, without copying them. Throws std::runtime_error if the file does not match the matrix type
+        void load_binary(const std::string& filename);
+
+        // Method to merge into the compressed vectors, in a single pass, the elements inserted by the non-const
+        // call operator in compressed state. References to the elements are invalidated
+        void finalize();
+
+        // Method to get the number of elements inserted in compressed state and not merged yet
+        std::size_t pending_size() const {
+            return pending.size();
+        }
+
+        // Method to freeze the pattern of a compressed matrix: pending insertions are merged and new elements
+        // can no longer be inserted, so that the slots returned by slot() stay valid while values change
+        void freeze_pattern() {
+            if (!compressed)
+                throw std::logic_error("SparseMatrix: only the pattern of a compressed matrix can be frozen");
+            finalize();
+            frozen = true;
+        }
+
+        // Method to allow again the insertion of new elements
+        void unfreeze_pattern() {
+            frozen = false;
+        }
+
+        // Method to check if the pattern is frozen
+        bool is_pattern_frozen() const {
+            return frozen;
+        }
+
+        // Method to get the slot (position in the values of the compressed matrix) of A_{i,j}, by binary search.
+        // Throws std::out_of_range if the element is not in the pattern
+        std::size_t slot(std::size_t i, std::size_t j) const;
+
+        // Method to get the slots of a list of (i,j) positions, e.g. the entries touched by an assembly loop
+        std::vector<std::size_t> slots(const std::vector<std::array<std::size_t, 2>>& positions) const;
+
+        // Method to access the value in a slot, O(1)
+        T& value_at(std::size_t s) {
+            detach();
+            return values[s];
+        }
+
+        // Method to read the value in a slot, O(1)
+        T value_at(std::size_t s) const {
+            return values_ptr()[s];
+        }
+
+        // Method to replace all the values of the compressed matrix (ordered by slot) in one pass
+        void set_values(const std::vector<T>& new_values);
+
+        // Method to set all the values of the compressed matrix to zero, keeping the pattern
+        void set_zero();
+
+        // Method to add the contributions to the values in the given slots: values[slots[k]] += contributions[k].
+        // Throws std::invalid_argument if the matrix is not finalized and compressed or the sizes differ, and
+        // std::out_of_range if a slot is out of range
+        void scatter_add(const std::vector<std::size_t>& slots, const std::vector<T>& contributions);
+
+        // Method to precompute a conflict-free parallel scatter of contributions into the given slots
+        ScatterPlan make_scatter_plan(const std::vector<std::size_t>& slots) const;
+
+        // Method to add contributions to the values with a precomputed plan, in parallel: each thread owns a
+        // range of slots. The result does not depend on the number of threads. Same exceptions as scatter_add(slots, ...)
+        void scatter_add(const ScatterPlan& plan, const std::vector<T>& contributions, std::size_t threads);
+
         // Method to check if the Sparse Matrix is compressed
         bool is_compressed() const {
             return compressed;
@@ -93,6 +363,114 @@ namespace algebra // Algebra namespace
         // Non-const call operator for adding elements
         T& operator()(std::size_t i, std::size_t j);
 
+        // Read-only forward iterator over the non-zeros (MatrixEntry) in storage order, in both states: the map
+        // when uncompressed, the compressed vectors followed by the pending elements when compressed
+        class const_iterator {
+        private:
+            const SparseMatrix* matrix = nullptr;
+            std::size_t outer = 0;                          // current row (column) in the compressed vectors
+            std::size_t k = 0;                              // current position in the compressed vectors
+            typename MapType::const_iterator it;            // current element of the map (data or pending)
+            bool in_map = false;
+
+            // Moves to the row (column) of position k, or to the pending elements after the last one
+            void settle() {
+                if (in_map)
+                    return;
+                const Index* first = matrix->first_ptr();
+                const std::size_t outerCount = matrix->outer_size();
+                while (outer < outerCount && k >= first[outer + 1])
+                    ++outer;
+                if (outer == outerCount) {
+                    in_map = true;
+                    it = matrix->pending.begin();
+                }
+            }
+
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using iterator_concept = std::forward_iterator_tag;
+            using value_type = MatrixEntry<T>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = MatrixEntry<T>;
+
+            const_iterator() = default;
+
+            const_iterator(const SparseMatrix* m, bool at_end) : matrix(m) {
+                if (!m->compressed) {
+                    in_map = true;
+                    it = at_end ? m->data.end() : m->data.begin();
+                } else if (at_end) {
+                    in_map = true;
+                    it = m->pending.end();
+                } else {
+                    settle();
+                }
+            }
+
+            MatrixEntry<T> operator*() const {
+                if (in_map)
+                    return {it->first[0], it->first[1], it->second};
+                const std::size_t inner = matrix->second_ptr()[k];
+                if constexpr (Order == StorageOrder::RowMajor)
+                    return {outer, inner, matrix->values_ptr()[k]};
+                else
+                    return {inner, outer, matrix->values_ptr()[k]};
+            }
+
+            const_iterator& operator++() {
+                if (in_map) {
+                    ++it;
+                } else {
+                    ++k;
+                    settle();
+                }
+                return *this;
+            }
+
+            const_iterator operator++(int) {
+                const_iterator old = *this;
+                ++*this;
+                return old;
+            }
+
+            bool operator==(const const_iterator& other) const {
+                return in_map == other.in_map && (in_map ? it == other.it : k == other.k);
+            }
+
+            bool operator!=(const const_iterator& other) const {
+                return !(*this == other);
+            }
+        };
+
+        const_iterator begin() const {
+            return const_iterator(this, false);
+        }
+
+        const_iterator end() const {
+            return const_iterator(this, true);
+        }
+
+        // Zero-copy views of row i of a compressed RowMajor matrix. Elements pending in the side buffer are not
+        // in the views (see finalize). Throw std::logic_error if the matrix is uncompressed
+        SparseVectorView<const T, Index> row(std::size_t i) const requires(Order == StorageOrder::RowMajor) {
+            return outer_view(i);
+        }
+
+        SparseVectorView<T, Index> mutable_row(std::size_t i) requires(Order == StorageOrder::RowMajor) {
+            return mutable_outer_view(i);
+        }
+
+        // Zero-copy views of column j of a compressed ColumnMajor matrix
+        SparseVectorView<const T, Index> col(std::size_t j) const requires(Order == StorageOrder::ColumnMajor) {
+            return outer_view(j);
+        }
+
+        SparseVectorView<T, Index> mutable_col(std::size_t j) requires(Order == StorageOrder::ColumnMajor) {
+            return mutable_outer_view(j);
+        }
+
         // Method to get the number of rows
         std::size_t get_rows() const {
             return num_rows;
@@ -103,41 +481,88 @@ namespace algebra // Algebra namespace
             return num_cols;
         }
 
-        
-// * friend operator between a Matrix and a vector
-friend std::vector<T> operator*(const SparseMatrix<T, Order>& M, const std::vector<T>& vec) {
-    const std::size_t numRows = M.num_rows;
-    const std::size_t numCols = M.num_cols;
+        // Method to get the number of elements stored in the compressed vectors (in the map when uncompressed).
+        // Elements pending in the side buffer are not counted (see finalize)
+        std::size_t get_nnz() const {
+            return compressed ? nnz() : data.size();
+        }
 
-    std::vector<T> result((Order == StorageOrder::RowMajor) ? numRows : numCols, 0);
+        // Read-only access to the compressed vectors, for the algorithms built on top of them (preconditioners,
+        // other formats). outer_indexes() has get_rows()+1 (RowMajor) or get_cols()+1 (ColumnMajor) entries,
+        // inner_indexes() and values_data() have get_nnz() entries. Valid while the matrix is compressed and unchanged
+        const Index* outer_indexes() const {
+            return first_ptr();
+        }
 
-    if constexpr (Order == StorageOrder::RowMajor) {
-        if (M.compressed) {
-            for (std::size_t i = 0; i < numRows; ++i) {
-                for (std::size_t j = M.first_indexes[i]; j < M.first_indexes[i + 1]; ++j) {
-                    result[i] += M.values[j] * vec[M.second_indexes[j]];
-                }
-            }
-        } else {
-            for (const auto& entry : M.data) {
-                result[entry.first[0]] += entry.second * vec[entry.first[1]];
-            }
+        const Index* inner_indexes() const {
+            return second_ptr();
         }
-    } else {
-        if (M.compressed) {
-            for (std::size_t i = 0; i < numCols; ++i) {
-                for (std::size_t j = M.first_indexes[i]; j < M.first_indexes[i + 1]; ++j) {
-                    result[M.second_indexes[j]] += M.values[j] * vec[i];
-                }
-            }
-        } else {
-            for (const auto& entry : M.data) {
-                result[entry.first[1]] += entry.second * vec[entry.first[0]];
-            }
+
+        const T* values_data() const {
+            return values_ptr();
         }
-    }
 
-    return result;
+        // Writable access to the values of the compressed matrix, for in-place operations that keep the pattern
+        // (a memory-mapped matrix is copied out of the file first)
+        T* mutable_values() {
+            detach();
+            return values.data();
+        }
+
+        // Method to set the number of threads used by operator* (1 means serial)
+        void set_num_threads(std::size_t threads) {
+            num_threads = std::max<std::size_t>(threads, 1);
+        }
+
+        // Method to get the number of threads used by operator*
+        std::size_t get_num_threads() const {
+            return num_threads;
+        }
+
+        // Matrix-vector product with an explicit number of threads
+        std::vector<T> multiply(const std::vector<T>& vec, std::size_t threads) const;
+
+        // Fused product y = alpha*M*x + beta*y that writes into an existing vector instead of allocating
+        // the result: y must have get_rows() entries (ignored if beta is 0) and x get_cols() entries
+        void multiply_into(std::vector<T>& y, const std::vector<T>& x, T alpha, T beta, std::size_t threads) const;
+
+        // Fused product y = alpha*M*x + beta*y using get_num_threads() threads
+        void multiply_into(std::vector<T>& y, const std::vector<T>& x, T alpha = T(1), T beta = T(0)) const {
+            multiply_into(y, x, alpha, beta, num_threads);
+        }
+
+        // Transposed product y = alpha*M^T*x + beta*y on the same storage (y has get_cols() entries)
+        void multiply_transpose_into(std::vector<T>& y, const std::vector<T>& x, T alpha, T beta, std::size_t threads) const;
+
+        // Transposed product y = alpha*M^T*x + beta*y using get_num_threads() threads
+        void multiply_transpose_into(std::vector<T>& y, const std::vector<T>& x, T alpha = T(1), T beta = T(0)) const {
+            multiply_transpose_into(y, x, alpha, beta, num_threads);
+        }
+
+        // Same as multiply_into for square matrices, returning the inner product conj(x)*y of the new y
+        // (x*A*x with the default alpha and beta). On compressed RowMajor matrices it is accumulated
+        // while y is written, so CG-like loops need no second pass over the vectors
+        T multiply_into_dot(std::vector<T>& y, const std::vector<T>& x, T alpha, T beta, std::size_t threads) const;
+
+        // Same as multiply_into_dot using get_num_threads() threads
+        T multiply_into_dot(std::vector<T>& y, const std::vector<T>& x, T alpha = T(1), T beta = T(0)) const {
+            return multiply_into_dot(y, x, alpha, beta, num_threads);
+        }
+
+        // Product with a block of k vectors stored row-major (X has get_cols()*k entries, X[j*k + c] is the
+        // entry j of vector c); returns the get_rows()*k block, also row-major. The matrix is streamed once
+        // for all the vectors
+        std::vector<T> multiply_block(const std::vector<T>& X, std::size_t k, std::size_t threads) const;
+
+        // Product with a block of k vectors using get_num_threads() threads
+        std::vector<T> multiply_block(const std::vector<T>& X, std::size_t k) const {
+            return multiply_block(X, k, num_threads);
+        }
+
+        
+// * friend operator between a Matrix and a vector
+friend std::vector<T> operator*(const SparseMatrix<T, Order, Index>& M, const std::vector<T>& vec) {
+    return M.multiply(vec, M.num_threads);
 };
     };
 
@@ -150,114 +575,72 @@ friend std::vector<T> operator*(const SparseMatrix<T, Order>& M, const std::vect
 
 
 // The following are method of Sparse Matrix Class to be put into the source file (.cpp)
-template<typename T, StorageOrder Order>
-algebra::SparseMatrix<T, Order>::SparseMatrix(std::string filename, bool compressed_) {
-    compressed = compressed_;
-    // Open the file
-    std::ifstream file(filename);
-    // Check if the file is opened successfully
-    if (!file.is_open()) {
-        std::cerr << "Error opening file: " << filename << std::endl;
+template<typename T, StorageOrder Order, typename Index>
+algebra::SparseMatrix<T, Order, Index>::SparseMatrix(std::string filename, bool compressed_) : compressed(false), num_rows(0), num_cols(0) {
+    // Read the file (memory-mapped and parsed in parallel)
+    mm::Triplets<T> triplets;
+    try {
+        triplets = mm::read<T>(filename);
+    } catch (const std::runtime_error& e) {
+        SPARSE_LOG(Error, e.what());
         return;
     }
 
-    // Read the first line of the file to get matrix dimensions
-    std::string line;
-    // M = num of rows, N = num of cols, L = num of non zero element in the matrix
-    std::size_t M, N, L;
-    while (getline(file, line) && line[0] == '%');
-    std::stringstream ss(line);
-    if (!(ss >> M >> N >> L)) {
-        std::cerr << "Invalid matrix market file format" << std::endl;
-        file.close();
-        return;
-    }
-    num_rows = M;
-    num_cols = N;
-
-    if (!compressed){
-        // Assemble COOmap matrix
-        std::size_t row, col;
-        T value;
-        while (file >> row >> col >> value) {
-            // Adjust indices to 0-based indexing and store data in map
-            data[{row - 1, col - 1}] = value;
-        }
-    }else{
-        if constexpr (Order == StorageOrder::ColumnMajor)
-            std::cerr << "This option is not implemented!" << std::endl;
-        
-        int last_row = 1;
-	    first_indexes.push_back(1);
-	    for (int l = 0; l < L; l++){
-	    	int row, col;
-	    	T value;
-	    	file >> row >> col >> value;
-	    	second_indexes.push_back(col);
-	    	values.push_back(value);
-	    	if (row > last_row){
-	    		last_row = row;
-	    		first_indexes.push_back(second_indexes.size());
-	    	}	
-	}
-	first_indexes.push_back(second_indexes.size() + 1);
-    }
-    
-    // Close the file
-    file.close();
-    std::cout << "Matrix read successfully from file: " << filename << std::endl;
-}
-
-
-template<typename T, StorageOrder Order>
-void algebra::SparseMatrix<T, Order>::read_mtx(std::string filename) {
-    // Clear previous data
-    if (compressed) {
-        first_indexes.clear();
-        second_indexes.clear();
-        values.clear();
+    if (compressed_) {
+        // Build CSR/CSC directly from the triplets
+        compress_from_triplets(triplets.header.rows, triplets.header.cols, triplets.rows, triplets.cols, triplets.values);
     } else {
-        data.clear();
+        // Assemble COOmap matrix
+        assign_triplets(triplets);
     }
 
-    // Open the file
-    std::ifstream file(filename);
-    // Error handling
-    if (!file.is_open()) {
-        std::cerr << "Error opening file: " << filename << std::endl;
-        return;
-    }
+    SPARSE_LOG(Info, "Matrix read successfully from file: " << filename);
+}
 
-    // Read the first line of the file to get matrix dimensions
-    std::string line;
-    // M = num of rows, N = num of cols, L = num of non zero element in the matrix
-    std::size_t M, N, L;
-    while (getline(file, line) && line[0] == '%');
-    std::stringstream ss(line);
-    if (!(ss >> M >> N >> L)) {
-        std::cerr << "Invalid matrix market file format" << std::endl;
-        file.close();
-        return;
-    }
-    num_rows = M;
-    num_cols = N;
 
-    // Read matrix data
-    std::size_t row, col;
-    T value;
-    while (file >> row >> col >> value) {
-        // Adjust indices to 0-based indexing and store data in map
-        data[{row - 1, col - 1}] = value;
+template<typename T, StorageOrder Order, typename Index>
+void algebra::SparseMatrix<T, Order, Index>::read_mtx(std::string filename) {
+    // Read the file (memory-mapped and parsed in parallel)
+    mm::Triplets<T> triplets;
+    try {
+        triplets = mm::read<T>(filename);
+    } catch (const std::runtime_error& e) {
+        SPARSE_LOG(Error, e.what());
+        return;
     }
-    // Close the file
-    file.close();
 
-    std::cout << "Sparse Matrix read successfully from file: " << filename << std::endl;
+    // Clear previous data
+    first_indexes.clear();
+    second_indexes.clear();
+    values.clear();
+    mapping.reset();
+    pending.clear();
+    clear_triplets();
+    frozen = false;
     compressed = false;
+
+    assign_triplets(triplets);
+
+    SPARSE_LOG(Info, "Sparse Matrix read successfully from file: " << filename);
+}
+
+template<typename T, StorageOrder Order, typename Index>
+void algebra::SparseMatrix<T, Order, Index>::assign_triplets(const mm::Triplets<T>& triplets) {
+    data.clear();
+    num_rows = triplets.header.rows;
+    num_cols = triplets.header.cols;
+    // Duplicated entries are summed up. When the file is sorted like the map, the hint
+    // makes every insertion O(1)
+    auto hint = data.end();
+    for (std::size_t k = 0; k < triplets.size(); ++k) {
+        auto it = data.emplace_hint(hint, IndexArray{triplets.rows[k], triplets.cols[k]}, T(0));
+        it->second += triplets.values[k];
+        hint = std::next(it);
+    }
 }
 
-template<typename T, StorageOrder Order>
-void algebra::SparseMatrix<T, Order>::print() {
+template<typename T, StorageOrder Order, typename Index>
+void algebra::SparseMatrix<T, Order, Index>::print() {
     if (!compressed) { // UNCOMPRESSED
         // Print matrix dimensions and number of non-zero elements
         std::cout << num_rows << " " << num_cols << " " << data.size() << std::endl;
@@ -267,36 +650,45 @@ void algebra::SparseMatrix<T, Order>::print() {
             std::cout << iter.first[0] + 1 << " " << iter.first[1] + 1 << " " << iter.second << std::endl;
         }
     } else { // COMPRESSED
+        finalize();
         // Print matrix dimensions and number of non-zero elements
-        std::cout << num_rows << " " << num_cols << " " << values.size() << std::endl;
+        std::cout << num_rows << " " << num_cols << " " << nnz() << std::endl;
+        const Index* first = first_ptr();
+        const Index* second = second_ptr();
+        const T* vals = values_ptr();
         if constexpr (Order == StorageOrder::RowMajor) { // ROW MAJOR FOR COMPRESSED
             // Loop over rows
             for (std::size_t i = 0; i < num_rows; i++) {
                 // Loop over non-zero elements of the ith row
-                for (std::size_t j = first_indexes[i]; j < first_indexes[i + 1]; j++) {
+                for (std::size_t j = first[i]; j < first[i + 1]; j++) {
                     // Print row, column, and value
-                    std::cout << i + 1 << " " << second_indexes[j] + 1 << " " << values[j] << std::endl;
+                    std::cout << i + 1 << " " << second[j] + 1 << " " << vals[j] << std::endl;
                 }
             }
         } else { // COLUMN MAJOR FOR COMPRESSED
             // Loop over columns
             for (std::size_t i = 0; i < num_cols; i++) {
                 // Loop over non-zero elements of ith column
-                for (std::size_t j = first_indexes[i]; j < first_indexes[i + 1]; j++) {
+                for (std::size_t j = first[i]; j < first[i + 1]; j++) {
                     // Print row, column, and value
-                    std::cout << second_indexes[j] + 1 << " " << i + 1 << " " << values[j] << std::endl;
+                    std::cout << second[j] + 1 << " " << i + 1 << " " << vals[j] << std::endl;
                 }
             }
         }
     }
 }
 
-template<typename T, StorageOrder Order>
-void algebra::SparseMatrix<T, Order>::resize(std::size_t rows, std::size_t cols){
+template<typename T, StorageOrder Order, typename Index>
+void algebra::SparseMatrix<T, Order, Index>::resize(std::size_t rows, std::size_t cols){
     // We cannot resize if the matrix is compressed
     if(is_compressed())
-        std::cerr<<"Error: We cannot resize if the matrix is compressed!"<<std::endl;
+        SPARSE_LOG(Error, "We cannot resize if the matrix is compressed!");
             
+    // Contributions of the assembly mode move to the map before renumbering
+    for (std::size_t k = 0; k < triplet_values.size(); ++k)
+        data[{triplet_rows[k], triplet_cols[k]}] += triplet_values[k];
+    clear_triplets();
+
     // New data!!!
     std::map<std::array<std::size_t,2>,T,MyComparator<Order>> new_data;
             
@@ -329,11 +721,11 @@ void algebra::SparseMatrix<T, Order>::resize(std::size_t rows, std::size_t cols)
 }
 
 
-template<typename T, StorageOrder Order>
-void algebra::SparseMatrix<T,Order>::compress(){
+template<typename T, StorageOrder Order, typename Index>
+void algebra::SparseMatrix<T, Order, Index>::compress(){
     // Check if the matrix is already compressed
     if(compressed){
-        std::cout << "Matrix already compressed" << std::endl;
+        SPARSE_LOG(Warning, "Matrix already compressed");
         return;
     }
 
@@ -341,93 +733,789 @@ void algebra::SparseMatrix<T,Order>::compress(){
     const size_t rowCount = (Order == StorageOrder::RowMajor) ? num_rows : num_cols;
     const size_t colCount = (Order == StorageOrder::RowMajor) ? num_cols : num_rows;
 
-    // Resize vectors for storing compressed data
-    first_indexes.resize(rowCount + 1);
-    second_indexes.reserve(data.size());
-    values.reserve(data.size());
+    // Check that indexes and non-zero counts fit in the index type
+    check_index_range(std::max(rowCount, colCount), "matrix dimension");
+    check_index_range(data.size() + triplet_values.size(), "number of non-zeros");
+
+    if (!triplet_values.empty()) {
+        // Contributions added with add(): the map entries join them and everything is sorted and merged at once
+        triplet_rows.reserve(triplet_rows.size() + data.size());
+        triplet_cols.reserve(triplet_cols.size() + data.size());
+        triplet_values.reserve(triplet_values.size() + data.size());
+        for (const auto& entry : data) {
+            triplet_rows.push_back(entry.first[0]);
+            triplet_cols.push_back(entry.first[1]);
+            triplet_values.push_back(entry.second);
+        }
+        compress_from_triplets(num_rows, num_cols, triplet_rows, triplet_cols, triplet_values);
+        clear_triplets();
+    } else {
+        // Single pass over the map, which is already sorted by row (column) and then by column (row):
+        // count the entries of each row (column) while copying them, then prefix sum the counts
+        SPARSE_TIMED_SCOPE(Compress);
+        first_indexes.assign(rowCount + 1, 0);
+        second_indexes.reserve(data.size());
+        values.reserve(data.size());
+        for (const auto& entry : data) {
+            const std::size_t outer = (Order == StorageOrder::RowMajor) ? entry.first[0] : entry.first[1];
+            const std::size_t inner = (Order == StorageOrder::RowMajor) ? entry.first[1] : entry.first[0];
+            ++first_indexes[outer + 1];
+            second_indexes.emplace_back(static_cast<Index>(inner));
+            values.emplace_back(entry.second);
+        }
+        for (size_t i = 0; i < rowCount; ++i)
+            first_indexes[i + 1] += first_indexes[i];
+
+        // Clear the original elements
+        data.clear();
+
+        // Set the compressed flag to true
+        compressed = true;
+    }
+
+    // Inform the user about successful compression
+    SPARSE_LOG(Info, "Matrix successfully compressed");
+}
 
-    // Initialize index for storing compressed data
-    size_t currentIndex = 0;
+template<typename T, StorageOrder Order, typename Index>
+void algebra::SparseMatrix<T, Order, Index>::compress_from_triplets(std::size_t rows, std::size_t cols, const std::vector<std::size_t>& row_indexes,
+                                                                   const std::vector<std::size_t>& col_indexes, const std::vector<T>& vals) {
+    const std::size_t nnz = vals.size();
+    if (row_indexes.size() != nnz || col_indexes.size() != nnz)
+        throw std::invalid_argument("SparseMatrix: triplet arrays of different sizes");
+    SPARSE_TIMED_SCOPE(Compress);
 
-    // Initialize first index for the compressed matrix
-    first_indexes[0] = 0;
+    // The compressed vectors store row/column indexes and non-zero counts
+    check_index_range(std::max(rows, cols), "matrix dimension");
+    check_index_range(nnz, "number of non-zeros");
 
-    // Loop over each row or column
-    for (size_t i = 0; i < rowCount; ++i) {
-        // Find lower and upper bounds for the current row or column
-        auto lower = data.lower_bound({(Order == StorageOrder::RowMajor) ? i : 0, (Order == StorageOrder::RowMajor) ? 0 : i});
-        auto upper = data.upper_bound({(Order == StorageOrder::RowMajor) ? i : colCount - 1, (Order == StorageOrder::RowMajor) ? colCount - 1 : i});
-        size_t count = 0; // Counter for non-zero elements in the current row or column
+    const std::size_t outerCount = (Order == StorageOrder::RowMajor) ? rows : cols;
+    const std::size_t innerCount = (Order == StorageOrder::RowMajor) ? cols : rows;
+    const std::vector<std::size_t>& outer = (Order == StorageOrder::RowMajor) ? row_indexes : col_indexes;
+    const std::vector<std::size_t>& inner = (Order == StorageOrder::RowMajor) ? col_indexes : row_indexes;
+
+    // Count the entries of each row (column), the prefix sum gives first_indexes
+    std::vector<Index> starts(outerCount + 1, 0);
+    for (std::size_t k = 0; k < nnz; ++k) {
+        if (outer[k] >= outerCount || inner[k] >= innerCount)
+            throw std::out_of_range("Index out of range");
+        ++starts[outer[k] + 1];
+    }
+    for (std::size_t i = 0; i < outerCount; ++i)
+        starts[i + 1] += starts[i];
 
-        // Loop over elements in the current row or column
-        for (auto k = lower; k != upper; ++k) {
-            // Store column or row index and value in the compressed format
-            second_indexes.emplace_back((Order == StorageOrder::RowMajor) ? k->first[1] : k->first[0]);
-            values.emplace_back(k->second);
-            ++count; // Increment count of non-zero elements
+    // Scatter every entry in its row (column)
+    std::vector<Index> idx(nnz);
+    std::vector<T> val(nnz);
+    {
+        std::vector<Index> next(starts.begin(), starts.end() - 1);
+        for (std::size_t k = 0; k < nnz; ++k) {
+            const Index pos = next[outer[k]]++;
+            idx[pos] = static_cast<Index>(inner[k]);
+            val[pos] = vals[k];
         }
+    }
+
+    // Sort every row (column) by second index, in parallel over blocks with the same number of entries
+    const std::size_t parts = std::max<std::size_t>(1, std::min(parallel::hardware_threads(), nnz / 65536));
+    const auto bounds = parallel::balanced_partition(starts.data(), outerCount, parts);
+    parallel::run(parts, [&](std::size_t t) {
+        for (std::size_t i = bounds[t]; i < bounds[t + 1]; ++i)
+            sort_segment(idx.data() + starts[i], val.data() + starts[i], starts[i + 1] - starts[i]);
+    });
 
-        // Update the next value of first_indexes according to the Compressed Sparse Row (CSR) format
-        currentIndex += count;
-        first_indexes[i + 1] = currentIndex;
+    // Merge the duplicates in place (the write position never overtakes the read one)
+    std::size_t w = 0;
+    for (std::size_t i = 0; i < outerCount; ++i) {
+        const std::size_t rowStart = w;
+        for (std::size_t j = starts[i]; j < starts[i + 1]; ++j) {
+            if (w > rowStart && idx[w - 1] == idx[j]) {
+                val[w - 1] += val[j];
+            } else {
+                idx[w] = idx[j];
+                val[w] = val[j];
+                ++w;
+            }
+        }
+        starts[i] = static_cast<Index>(rowStart);
     }
+    starts[outerCount] = static_cast<Index>(w);
+    idx.resize(w);
+    val.resize(w);
 
-    // Clear the original elements
+    // Replace the content of the matrix
     data.clear();
+    num_rows = rows;
+    num_cols = cols;
+    first_indexes = std::move(starts);
+    second_indexes = std::move(idx);
+    values = std::move(val);
+    mapping.reset();
+    pending.clear();
+    clear_triplets();
+    frozen = false;
+    compressed = true;
+}
+
+template<typename T, StorageOrder Order, typename Index>
+void algebra::SparseMatrix<T, Order, Index>::assign_compressed(std::size_t rows, std::size_t cols, std::vector<Index>&& outer,
+                                                              std::vector<Index>&& inner, std::vector<T>&& vals) {
+    check_index_range(std::max(rows, cols), "matrix dimension");
+    const std::size_t outerCount = (Order == StorageOrder::RowMajor) ? rows : cols;
+    const std::size_t innerCount = (Order == StorageOrder::RowMajor) ? cols : rows;
+    if (outer.size() != outerCount + 1 || outer[0] != 0 || outer[outerCount] != inner.size() || inner.size() != vals.size())
+        throw std::invalid_argument("SparseMatrix: compressed vectors of inconsistent sizes");
+    for (std::size_t i = 0; i < outerCount; ++i) {
+        if (outer[i] > outer[i + 1])
+            throw std::invalid_argument("SparseMatrix: decreasing outer indexes");
+        for (std::size_t k = outer[i]; k < outer[i + 1]; ++k)
+            if (inner[k] >= innerCount || (k > outer[i] && inner[k - 1] >= inner[k]))
+                throw std::invalid_argument("SparseMatrix: inner indexes out of range or not sorted");
+    }
 
-    // Set the compressed flag to true
+    // Replace the content of the matrix
+    data.clear();
+    num_rows = rows;
+    num_cols = cols;
+    first_indexes = std::move(outer);
+    second_indexes = std::move(inner);
+    values = std::move(vals);
+    mapping.reset();
+    pending.clear();
+    clear_triplets();
+    frozen = false;
     compressed = true;
+}
 
-    // Inform the user about successful compression
-    std::cout << "Matrix successfully compressed!!!!:)" << std::endl;
+template<typename T, StorageOrder Order, typename Index>
+void algebra::SparseMatrix<T, Order, Index>::sort_segment(Index* idx, T* val, std::size_t n) {
+    if (std::is_sorted(idx, idx + n))
+        return;
+    if (n <= 32) {
+        // Insertion sort for the (usual) short rows
+        for (std::size_t a = 1; a < n; ++a) {
+            const Index key = idx[a];
+            const T v = val[a];
+            std::size_t b = a;
+            for (; b > 0 && idx[b - 1] > key; --b) {
+                idx[b] = idx[b - 1];
+                val[b] = val[b - 1];
+            }
+            idx[b] = key;
+            val[b] = v;
+        }
+        return;
+    }
+    std::vector<std::pair<Index, T>> tmp(n);
+    for (std::size_t a = 0; a < n; ++a)
+        tmp[a] = {idx[a], val[a]};
+    std::stable_sort(tmp.begin(), tmp.end(), [](const auto& l, const auto& r) { return l.first < r.first; });
+    for (std::size_t a = 0; a < n; ++a) {
+        idx[a] = tmp[a].first;
+        val[a] = tmp[a].second;
+    }
+}
+
+template<typename T, StorageOrder Order, typename Index>
+void algebra::SparseMatrix<T, Order, Index>::save_binary(const std::string& filename) const {
+    static_assert(std::is_trivially_copyable_v<T>, "save_binary needs a trivially copyable value type");
+    if (!compressed || !pending.empty()) {
+        SparseMatrix<T, Order, Index> copy(*this);
+        if (!copy.is_compressed())
+            copy.compress();
+        copy.finalize();
+        copy.save_binary(filename);
+        return;
+    }
+    const std::size_t outerCount = (Order == StorageOrder::RowMajor) ? num_rows : num_cols;
+
+    binary::Header header{};
+    std::memcpy(header.magic, binary::magic, sizeof(header.magic));
+    header.version = binary::version;
+    header.endian = binary::endian_tag;
+    header.order = (Order == StorageOrder::RowMajor) ? 0 : 1;
+    header.value_type = static_cast<std::uint32_t>(binary::value_type<T>());
+    header.value_size = sizeof(T);
+    header.index_size = sizeof(Index);
+    header.rows = num_rows;
+    header.cols = num_cols;
+    header.nnz = nnz();
+    header.first_offset = binary::align(sizeof(binary::Header));
+    header.second_offset = binary::align(header.first_offset + (outerCount + 1) * sizeof(Index));
+    header.values_offset = binary::align(header.second_offset + nnz() * sizeof(Index));
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+        throw std::runtime_error("Error opening file: " + filename);
+
+    // Writes a block at the given offset, padding with zeros
+    std::uint64_t position = 0;
+    auto write_block = [&](std::uint64_t offset, const void* ptr, std::size_t bytes) {
+        static const char zeros[binary::alignment] = {};
+        file.write(zeros, static_cast<std::streamsize>(offset - position));
+        file.write(static_cast<const char*>(ptr), static_cast<std::streamsize>(bytes));
+        position = offset + bytes;
+    };
+    write_block(0, &header, sizeof(header));
+    write_block(header.first_offset, first_ptr(), (outerCount + 1) * sizeof(Index));
+    write_block(header.second_offset, second_ptr(), nnz() * sizeof(Index));
+    write_block(header.values_offset, values_ptr(), nnz() * sizeof(T));
+    if (!file)
+        throw std::runtime_error("Error writing file: " + filename);
+}
+
+template<typename T, StorageOrder Order, typename Index>
+void algebra::SparseMatrix<T, Order, Index>::load_binary(const std::string& filename) {
+    static_assert(std::is_trivially_copyable_v<T>, "load_binary needs a trivially copyable value type");
+    // The arrays stay mapped and the products read them at random
+    auto file = std::make_shared<MappedFile>(filename, MapAccess::Resident);
+
+    // Check the header against the type of this matrix
+    binary::Header header;
+    if (file->size() < sizeof(header))
+        throw std::runtime_error("Not a sparse matrix binary file: " + filename);
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (std::memcmp(header.magic, binary::magic, sizeof(header.magic)) != 0)
+        throw std::runtime_error("Not a sparse matrix binary file: " + filename);
+    if (header.version != binary::version)
+        throw std::runtime_error("Unsupported binary format version " + std::to_string(header.version) + ": " + filename);
+    if (header.endian != binary::endian_tag)
+        throw std::runtime_error("Binary file written with a different endianness: " + filename);
+    if (header.order != ((Order == StorageOrder::RowMajor) ? 0u : 1u))
+        throw std::runtime_error("Binary file stored with a different storage order: " + filename);
+    if (header.value_type != static_cast<std::uint32_t>(binary::value_type<T>()) || header.value_size != sizeof(T))
+        throw std::runtime_error("Binary file stored with a different value type: " + filename);
+    if (header.index_size != sizeof(Index))
+        throw std::runtime_error("Binary file stored with " + std::to_string(8 * header.index_size) + "-bit indexes: " + filename);
+
+    const std::uint64_t outerCount = (header.order == 0) ? header.rows : header.cols;
+    const std::uint64_t innerCount = (header.order == 0) ? header.cols : header.rows;
+    const bool aligned = header.first_offset % alignof(Index) == 0 && header.second_offset % alignof(Index) == 0 &&
+                         header.values_offset % alignof(T) == 0;
+    // Number of elements of the given size between an offset and the end of the file (no overflow)
+    auto available = [&](std::uint64_t offset, std::size_t size) -> std::uint64_t {
+        return offset <= file->size() ? (file->size() - offset) / size : 0;
+    };
+    if (!aligned || outerCount >= available(header.first_offset, sizeof(Index)) ||
+        header.nnz > available(header.second_offset, sizeof(Index)) || header.nnz > available(header.values_offset, sizeof(T)))
+        throw std::runtime_error("Truncated binary file: " + filename);
+
+    // Check the content of the index arrays, which the kernels use without bounds checks: outer indexes
+    // from 0 to nnz, non-decreasing, and inner indexes in range and strictly increasing in every row (column)
+    const Index* first = reinterpret_cast<const Index*>(file->data() + header.first_offset);
+    const Index* second = reinterpret_cast<const Index*>(file->data() + header.second_offset);
+    if (first[0] != 0 || first[outerCount] != header.nnz)
+        throw std::runtime_error("Corrupted binary file (invalid outer indexes): " + filename);
+    for (std::uint64_t i = 0; i < outerCount; ++i) {
+        if (first[i] > first[i + 1])
+            throw std::runtime_error("Corrupted binary file (invalid outer indexes): " + filename);
+        for (std::uint64_t k = first[i]; k < first[i + 1]; ++k)
+            if (second[k] >= innerCount || (k > first[i] && second[k - 1] >= second[k]))
+                throw std::runtime_error("Corrupted binary file (inner indexes out of range or not sorted): " + filename);
+    }
+
+    // Use the arrays in place
+    data.clear();
+    first_indexes.clear();
+    second_indexes.clear();
+    values.clear();
+    pending.clear();
+    clear_triplets();
+    frozen = false;
+    num_rows = header.rows;
+    num_cols = header.cols;
+    mapped_first = first;
+    mapped_second = second;
+    mapped_values = reinterpret_cast<const T*>(file->data() + header.values_offset);
+    mapped_nnz = header.nnz;
+    mapping = std::move(file);
+    compressed = true;
+}
+
+template<typename T, StorageOrder Order, typename Index>
+void algebra::SparseMatrix<T, Order, Index>::finalize() {
+    if (!compressed || pending.empty())
+        return;
+    SPARSE_TIMED_SCOPE(Finalize);
+    const std::size_t outerCount = (Order == StorageOrder::RowMajor) ? num_rows : num_cols;
+    const std::size_t total = nnz() + pending.size();
+    check_index_range(total, "number of non-zeros");
+
+    const Index* first = first_ptr();
+    const Index* second = second_ptr();
+    const T* vals = values_ptr();
+    std::vector<Index> new_first(outerCount + 1);
+    std::vector<Index> new_second(total);
+    std::vector<T> new_values(total);
+
+    // The side buffer is sorted like the compressed vectors (by row, then column, for RowMajor):
+    // merge the two sorted sequences row by row (column by column)
+    auto it = pending.begin();
+    std::size_t w = 0;
+    for (std::size_t i = 0; i < outerCount; ++i) {
+        new_first[i] = static_cast<Index>(w);
+        std::size_t k = first[i];
+        const std::size_t end = first[i + 1];
+        for (; it != pending.end() && it->first[(Order == StorageOrder::RowMajor) ? 0 : 1] == i; ++it) {
+            const std::size_t inner = it->first[(Order == StorageOrder::RowMajor) ? 1 : 0];
+            for (; k < end && second[k] < inner; ++k, ++w) {
+                new_second[w] = second[k];
+                new_values[w] = vals[k];
+            }
+            new_second[w] = static_cast<Index>(inner);
+            new_values[w] = it->second;
+            ++w;
+        }
+        for (; k < end; ++k, ++w) {
+            new_second[w] = second[k];
+            new_values[w] = vals[k];
+        }
+    }
+    new_first[outerCount] = static_cast<Index>(w);
+
+    first_indexes = std::move(new_first);
+    second_indexes = std::move(new_second);
+    values = std::move(new_values);
+    mapping.reset();
+    pending.clear();
+}
+
+template<typename T, StorageOrder Order, typename Index>
+std::size_t algebra::SparseMatrix<T, Order, Index>::slot(std::size_t i, std::size_t j) const {
+    if (!compressed)
+        throw std::logic_error("SparseMatrix: slots exist only in compressed state");
+    if (i >= num_rows || j >= num_cols)
+        throw std::out_of_range("Index out of range");
+    const std::size_t outer = (Order == StorageOrder::RowMajor) ? i : j;
+    const std::size_t inner = (Order == StorageOrder::RowMajor) ? j : i;
+    const Index* first = first_ptr();
+    const Index* second = second_ptr();
+    // Second indexes are sorted inside every row (column)
+    const Index* begin = second + first[outer];
+    const Index* end = second + first[outer + 1];
+    const Index* it = std::lower_bound(begin, end, inner);
+    if (it == end || *it != inner)
+        throw std::out_of_range("Element not in the pattern");
+    return static_cast<std::size_t>(it - second);
+}
+
+template<typename T, StorageOrder Order, typename Index>
+std::vector<std::size_t> algebra::SparseMatrix<T, Order, Index>::slots(const std::vector<std::array<std::size_t, 2>>& positions) const {
+    std::vector<std::size_t> result(positions.size());
+    for (std::size_t k = 0; k < positions.size(); ++k)
+        result[k] = slot(positions[k][0], positions[k][1]);
+    return result;
+}
+
+template<typename T, StorageOrder Order, typename Index>
+void algebra::SparseMatrix<T, Order, Index>::set_values(const std::vector<T>& new_values) {
+    if (!compressed || !pending.empty() || new_values.size() != nnz())
+        throw std::invalid_argument("SparseMatrix: set_values needs one value per slot of a finalized compressed matrix");
+    if (mapping) {
+        // Only the pattern has to be copied out of the memory-mapped file
+        const std::size_t outerCount = (Order == StorageOrder::RowMajor) ? num_rows : num_cols;
+        first_indexes.assign(mapped_first, mapped_first + outerCount + 1);
+        second_indexes.assign(mapped_second, mapped_second + mapped_nnz);
+        mapping.reset();
+    }
+    values = new_values;
+}
+
+template<typename T, StorageOrder Order, typename Index>
+void algebra::SparseMatrix<T, Order, Index>::set_zero() {
+    detach();
+    std::fill(values.begin(), values.end(), T(0));
+    for (auto& entry : pending)
+        entry.second = 0;
+}
+
+template<typename T, StorageOrder Order, typename Index>
+void algebra::SparseMatrix<T, Order, Index>::scatter_add(const std::vector<std::size_t>& slots, const std::vector<T>& contributions) {
+    if (!compressed || !pending.empty() || contributions.size() != slots.size())
+        throw std::invalid_argument("SparseMatrix: scatter_add needs one contribution per slot of a finalized compressed matrix");
+    const std::size_t n = nnz();
+    for (const auto s : slots)
+        if (s >= n)
+            throw std::out_of_range("Slot out of range");
+    detach();
+    T* vals = values.data();
+    for (std::size_t k = 0; k < slots.size(); ++k)
+        vals[slots[k]] += contributions[k];
+}
+
+template<typename T, StorageOrder Order, typename Index>
+algebra::ScatterPlan algebra::SparseMatrix<T, Order, Index>::make_scatter_plan(const std::vector<std::size_t>& slots) const {
+    // Stable counting sort of the contributions by slot, O(contributions + nnz)
+    const std::size_t n = nnz();
+    std::vector<std::size_t> start(n + 1, 0);
+    for (const auto s : slots) {
+        if (s >= n)
+            throw std::out_of_range("Slot out of range");
+        ++start[s + 1];
+    }
+    for (std::size_t s = 0; s < n; ++s)
+        start[s + 1] += start[s];
+    ScatterPlan plan;
+    plan.order.resize(slots.size());
+    plan.slots.resize(slots.size());
+    for (std::size_t k = 0; k < slots.size(); ++k) {
+        const std::size_t pos = start[slots[k]]++;
+        plan.order[pos] = k;
+        plan.slots[pos] = slots[k];
+    }
+    return plan;
+}
+
+template<typename T, StorageOrder Order, typename Index>
+void algebra::SparseMatrix<T, Order, Index>::scatter_add(const ScatterPlan& plan, const std::vector<T>& contributions, std::size_t threads) {
+    if (!compressed || !pending.empty() || contributions.size() != plan.order.size() || plan.slots.size() != plan.order.size())
+        throw std::invalid_argument("SparseMatrix: scatter_add needs one contribution per slot of a finalized compressed matrix");
+    // The slots of a plan are sorted: a plan made for a larger pattern ends with a slot out of range
+    if (!plan.slots.empty() && plan.slots.back() >= nnz())
+        throw std::out_of_range("Slot out of range");
+    detach();
+    T* vals = values.data();
+    const std::size_t n = plan.order.size();
+    const std::size_t parts = std::max<std::size_t>(1, std::min(threads, n));
+    // Chunk boundaries are moved forward so that all the contributions to one slot go to the same thread
+    std::vector<std::size_t> bounds(parts + 1, n);
+    bounds[0] = 0;
+    for (std::size_t t = 1; t < parts; ++t) {
+        std::size_t b = std::max(bounds[t - 1], n * t / parts);
+        while (b > 0 && b < n && plan.slots[b] == plan.slots[b - 1])
+            ++b;
+        bounds[t] = b;
+    }
+    parallel::run(parts, [&](std::size_t t) {
+        for (std::size_t k = bounds[t]; k < bounds[t + 1]; ++k)
+            vals[plan.slots[k]] += contributions[plan.order[k]];
+    });
 }
 
-template<typename T, StorageOrder Order>
-void algebra::SparseMatrix<T,Order>::uncompress(){
+template<typename T, StorageOrder Order, typename Index>
+void algebra::SparseMatrix<T, Order, Index>::detach() {
+    if (!mapping)
+        return;
+    const std::size_t outerCount = (Order == StorageOrder::RowMajor) ? num_rows : num_cols;
+    first_indexes.assign(mapped_first, mapped_first + outerCount + 1);
+    second_indexes.assign(mapped_second, mapped_second + mapped_nnz);
+    values.assign(mapped_values, mapped_values + mapped_nnz);
+    mapping.reset();
+}
+
+template<typename T, StorageOrder Order, typename Index>
+void algebra::SparseMatrix<T, Order, Index>::uncompress(){
     // Check if matrix is already uncompressed
     if(!compressed){
-        std::cout << "Matrix already uncompressed" << std::endl;
+        SPARSE_LOG(Warning, "Matrix already uncompressed");
         return;
     }
+    SPARSE_TIMED_SCOPE(Uncompress);
+
+    const Index* first = first_ptr();
+    const Index* second = second_ptr();
+    const T* vals = values_ptr();
 
     // Uncompressed mode
     if constexpr(Order == StorageOrder::RowMajor) {
         // Loop over the rows
         for(std::size_t i = 0; i < num_rows; ++i) {
             // Loop over non-zero elements of the row
-            for(std::size_t j = first_indexes[i]; j < first_indexes[i + 1]; ++j) {
+            for(std::size_t j = first[i]; j < first[i + 1]; ++j) {
                 // Define the key of the map
-                std::array<std::size_t, 2> ii = {i, second_indexes[j]};
+                std::array<std::size_t, 2> ii = {i, second[j]};
                 // Assign the value
-                data[ii] = values[j];
+                data[ii] = vals[j];
             }
         }
     } else {
         // Loop over the columns
         for(std::size_t i = 0; i < num_cols; ++i) {
             // Loop over non-zero elements of the column
-            for(std::size_t j = first_indexes[i]; j < first_indexes[i + 1]; ++j) {
+            for(std::size_t j = first[i]; j < first[i + 1]; ++j) {
                 // Define the key of the map
-                std::array<std::size_t, 2> ii = {second_indexes[j], i};
+                std::array<std::size_t, 2> ii = {second[j], i};
                 // Assign the value
-                data[ii] = values[j];
+                data[ii] = vals[j];
             }
         }
     }
 
+    // Elements inserted in compressed state
+    for (const auto& entry : pending)
+        data[entry.first] += entry.second;
+    pending.clear();
+
     // Set compressed value to false
     compressed = false;
+    frozen = false;
 
     // Clear memory space of compressed matrix
     first_indexes.clear();
     second_indexes.clear();
     values.clear();
-    std::cout << "Matrix successfully uncompressed!!!!!!!! :)" << std::endl;
+    mapping.reset();
+    SPARSE_LOG(Info, "Matrix successfully uncompressed");
+}
+
+
+template<typename T, StorageOrder Order, typename Index>
+std::vector<T> algebra::SparseMatrix<T, Order, Index>::multiply(const std::vector<T>& vec, std::size_t threads) const {
+    check_product_sizes(num_rows, vec.size(), false);
+    std::vector<T> result(num_rows);
+    product_into(result.data(), vec.data(), T(1), T(0), false, threads, false);
+    return result;
+}
+
+template<typename T, StorageOrder Order, typename Index>
+void algebra::SparseMatrix<T, Order, Index>::multiply_into(std::vector<T>& y, const std::vector<T>& x, T alpha, T beta, std::size_t threads) const {
+    check_product_sizes(y.size(), x.size(), false);
+    product_into(y.data(), x.data(), alpha, beta, false, threads, false);
+}
+
+template<typename T, StorageOrder Order, typename Index>
+void algebra::SparseMatrix<T, Order, Index>::multiply_transpose_into(std::vector<T>& y, const std::vector<T>& x, T alpha, T beta, std::size_t threads) const {
+    check_product_sizes(y.size(), x.size(), true);
+    product_into(y.data(), x.data(), alpha, beta, true, threads, false);
+}
+
+template<typename T, StorageOrder Order, typename Index>
+T algebra::SparseMatrix<T, Order, Index>::multiply_into_dot(std::vector<T>& y, const std::vector<T>& x, T alpha, T beta, std::size_t threads) const {
+    if (num_rows != num_cols)
+        throw std::invalid_argument("SparseMatrix: multiply_into_dot needs a square matrix");
+    check_product_sizes(y.size(), x.size(), false);
+    return product_into(y.data(), x.data(), alpha, beta, false, threads, true);
 }
 
+template<typename T, StorageOrder Order, typename Index>
+void algebra::SparseMatrix<T, Order, Index>::check_product_sizes(std::size_t y_size, std::size_t x_size, bool transpose) const {
+    const std::size_t rows = transpose ? num_cols : num_rows;
+    const std::size_t cols = transpose ? num_rows : num_cols;
+    if (x_size != cols || y_size != rows)
+        throw std::invalid_argument("SparseMatrix: vector sizes do not match the matrix (" + std::to_string(num_rows) + "x" + std::to_string(num_cols) + ")");
+}
+
+template<typename T, StorageOrder Order, typename Index>
+T algebra::SparseMatrix<T, Order, Index>::product_into(T* y, const T* x, T alpha, T beta, bool transpose, std::size_t threads, bool dot) const {
+    SPARSE_TIMED_SCOPE(Spmv);
+    const std::size_t n = transpose ? num_cols : num_rows;
+    // Rows of op(M) are contiguous for CSR*x and CSC^T*x
+    const bool gather = compressed && ((Order == StorageOrder::RowMajor) != transpose);
+    const bool fused_dot = dot && gather && pending.empty();
+    T result = 0;
+
+    if (gather) {
+        result = gather_into(y, x, alpha, beta, threads, fused_dot);
+    } else {
+        parallel::for_range(n, threads, [&](std::size_t begin, std::size_t end) {
+            if (beta == T(0))
+                std::fill(y + begin, y + end, T(0));
+            else if (beta != T(1))
+                for (std::size_t i = begin; i < end; ++i)
+                    y[i] *= beta;
+        });
+        if (compressed) {
+            scatter_product(x, y, 1, alpha, threads);
+        } else {
+            for (const auto& entry : data) {
+                const std::size_t r = transpose ? entry.first[1] : entry.first[0];
+                const std::size_t c = transpose ? entry.first[0] : entry.first[1];
+                y[r] += alpha * entry.second * x[c];
+            }
+        }
+    }
+
+    // Elements inserted in compressed state and not merged yet
+    if (compressed) {
+        for (const auto& entry : pending) {
+            const std::size_t r = transpose ? entry.first[1] : entry.first[0];
+            const std::size_t c = transpose ? entry.first[0] : entry.first[1];
+            y[r] += alpha * entry.second * x[c];
+        }
+    }
 
-template<typename T, StorageOrder Order>
-T algebra::SparseMatrix<T,Order>::operator()(std::size_t i, std::size_t j) const {
+    if (dot && !fused_dot) {
+        for (std::size_t i = 0; i < n; ++i)
+            result += kernels::conj(x[i]) * y[i];
+    }
+    return result;
+}
+
+template<typename T, StorageOrder Order, typename Index>
+T algebra::SparseMatrix<T, Order, Index>::gather_into(T* y, const T* x, T alpha, T beta, std::size_t threads, bool dot) const {
+    const std::size_t n = outer_size();
+    const T* vals = values_ptr();
+    const Index* outer = first_ptr();
+    const Index* inner = second_ptr();
+
+    // Product on the outer indexes [begin, end), returns the partial dot product
+    auto block = [&](std::size_t begin, std::size_t end) {
+        T d = 0;
+        if (alpha == T(1) && beta == T(0) && !dot) {
+            kernels::csr_multiply(vals, outer, inner, x, y, begin, end);
+            return d;
+        }
+        // The rows are computed in small blocks on the stack, so that the update of y and
+        // the dot product read them while they are still in cache
+        constexpr std::size_t chunk = 256;
+        T tmp[chunk];
+        for (std::size_t b = begin; b < end; b += chunk) {
+            const std::size_t len = std::min(chunk, end - b);
+            T* yb = y + b;
+            const T* xb = x + b;
+            kernels::csr_multiply(vals, outer + b, inner, x, tmp, 0, len);
+            if (beta == T(0)) {
+                for (std::size_t i = 0; i < len; ++i)
+                    yb[i] = alpha * tmp[i];
+            } else {
+                for (std::size_t i = 0; i < len; ++i)
+                    yb[i] = alpha * tmp[i] + beta * yb[i];
+            }
+            if (dot) {
+                // Four partial sums, to break the dependency chain of the additions
+                T d4[4] = {T(0), T(0), T(0), T(0)};
+                std::size_t i = 0;
+                for (; i + 4 <= len; i += 4)
+                    for (std::size_t l = 0; l < 4; ++l)
+                        d4[l] += kernels::conj(xb[i + l]) * yb[i + l];
+                for (; i < len; ++i)
+                    d4[0] += kernels::conj(xb[i]) * yb[i];
+                d += (d4[0] + d4[1]) + (d4[2] + d4[3]);
+            }
+        }
+        return d;
+    };
+
+    const std::size_t parts = std::max<std::size_t>(1, std::min(threads, n));
+    if (parts == 1)
+        return block(0, n);
+    // Same partition as multiply; the partial dot products are summed in a fixed order
+    const auto bounds = parallel::balanced_partition(outer, n, parts);
+    std::vector<T> partial(parts, T(0));
+    parallel::run(parts, [&](std::size_t t) {
+        partial[t] = block(bounds[t], bounds[t + 1]);
+    });
+    T result = 0;
+    for (const T& d : partial)
+        result += d;
+    return result;
+}
+
+template<typename T, StorageOrder Order, typename Index>
+std::vector<T> algebra::SparseMatrix<T, Order, Index>::multiply_block(const std::vector<T>& X, std::size_t k, std::size_t threads) const {
+    if (k == 0 || X.size() != num_cols * k)
+        throw std::invalid_argument("SparseMatrix: the block of vectors must have cols*k entries");
+    SPARSE_TIMED_SCOPE(Spmv);
+    std::vector<T> result(num_rows * k, 0);
+    if (compressed) {
+        multiply_compressed(X.data(), result.data(), k, threads);
+    } else {
+        for (const auto& entry : data) {
+            const T v = entry.second;
+            const T* xr = X.data() + entry.first[1] * k;
+            T* yr = result.data() + entry.first[0] * k;
+            for (std::size_t c = 0; c < k; ++c)
+                yr[c] += v * xr[c];
+        }
+    }
+    return result;
+}
+
+template<typename T, StorageOrder Order, typename Index>
+void algebra::SparseMatrix<T, Order, Index>::multiply_compressed(const T* x, T* y, std::size_t k, std::size_t threads) const {
+    if constexpr (Order == StorageOrder::RowMajor) {
+        // Rows are split by number of non-zeros, so that a few long rows do not stall one thread.
+        // Each row is computed by a single thread in the same order as the serial loop,
+        // hence the result does not depend on the number of threads.
+        const std::size_t parts = std::max<std::size_t>(1, std::min(threads, num_rows));
+        const auto bounds = parallel::balanced_partition(first_ptr(), num_rows, parts);
+        parallel::run(parts, [&](std::size_t t) {
+            kernels::csr_multiply_block(values_ptr(), first_ptr(), second_ptr(), x, y, k, bounds[t], bounds[t + 1]);
+        });
+    } else {
+        // The product of a CSC matrix scatters into the rows of the result
+        std::fill(y, y + num_rows * k, T(0));
+        scatter_product(x, y, k, T(1), threads);
+    }
+
+    // Elements inserted in compressed state and not merged yet
+    for (const auto& entry : pending) {
+        for (std::size_t c = 0; c < k; ++c)
+            y[entry.first[0] * k + c] += entry.second * x[entry.first[1] * k + c];
+    }
+}
+
+template<typename T, StorageOrder Order, typename Index>
+void algebra::SparseMatrix<T, Order, Index>::scatter_product(const T* x, T* y, std::size_t k, T alpha, std::size_t threads) const {
+    const std::size_t n_outer = outer_size();
+    const std::size_t n_inner = inner_size();
+    const std::size_t parts = std::max<std::size_t>(1, std::min(threads, n_outer));
+    if (parts == 1) {
+        kernels::csc_multiply_block(values_ptr(), first_ptr(), second_ptr(), x, y, k, 0, n_outer, alpha);
+        return;
+    }
+    // Choose the strategy with the lower extra work: the privatized one zeroes and reduces
+    // parts*n_inner entries, the row-blocked one does one binary search per outer index and thread.
+    // Private copies are also avoided when they would take more memory than the matrix itself.
+    const std::size_t nonzeros = nnz();
+    const std::size_t avg_outer = std::max<std::size_t>(2, nonzeros / std::max<std::size_t>(n_outer, 1));
+    std::size_t log_outer = 1;
+    while ((std::size_t(1) << log_outer) < avg_outer)
+        ++log_outer;
+    const std::size_t privatized_cost = parts * n_inner * k;
+    const std::size_t row_blocked_cost = parts * n_outer * log_outer;
+    if (privatized_cost <= row_blocked_cost && (parts - 1) * n_inner <= 2 * nonzeros)
+        scatter_privatized(x, y, k, alpha, parts);
+    else
+        scatter_row_blocked(x, y, k, alpha, parts);
+}
+
+template<typename T, StorageOrder Order, typename Index>
+void algebra::SparseMatrix<T, Order, Index>::scatter_privatized(const T* x, T* y, std::size_t k, T alpha, std::size_t threads) const {
+    // Outer indexes are split by number of non-zeros, thread 0 writes directly into y
+    const std::size_t n_inner = inner_size();
+    const auto bounds = parallel::balanced_partition(first_ptr(), outer_size(), threads);
+    std::vector<std::vector<T>> partial(threads - 1);
+    parallel::run(threads, [&](std::size_t t) {
+        T* out = y;
+        if (t > 0) {
+            partial[t - 1].assign(n_inner * k, 0);
+            out = partial[t - 1].data();
+        }
+        kernels::csc_multiply_block(values_ptr(), first_ptr(), second_ptr(), x, out, k, bounds[t], bounds[t + 1], alpha);
+    });
+    // Reduction: every thread sums the private copies over its own block of rows
+    parallel::for_range(n_inner * k, threads, [&](std::size_t begin, std::size_t end) {
+        for (const auto& p : partial)
+            for (std::size_t r = begin; r < end; ++r)
+                y[r] += p[r];
+    });
+}
+
+template<typename T, StorageOrder Order, typename Index>
+void algebra::SparseMatrix<T, Order, Index>::scatter_row_blocked(const T* x, T* y, std::size_t k, T alpha, std::size_t threads) const {
+    // No write conflicts: each thread only writes the rows of its own block
+    const std::size_t n_outer = outer_size();
+    const Index* first_idx = first_ptr();
+    const Index* second = second_ptr();
+    const T* vals = values_ptr();
+    parallel::for_range(inner_size(), threads, [&](std::size_t row_begin, std::size_t row_end) {
+        for (std::size_t i = 0; i < n_outer; ++i) {
+            const Index* first = second + first_idx[i];
+            const Index* last = second + first_idx[i + 1];
+            const T* xr = x + i * k;
+            for (const Index* it = std::lower_bound(first, last, row_begin); it != last && *it < row_end; ++it) {
+                const T v = alpha * vals[it - second];
+                T* yr = y + static_cast<std::size_t>(*it) * k;
+                for (std::size_t c = 0; c < k; ++c)
+                    yr[c] += v * xr[c];
+            }
+        }
+    });
+}
+
+template<typename T, StorageOrder Order, typename Index>
+T algebra::SparseMatrix<T, Order, Index>::operator()(std::size_t i, std::size_t j) const {
     // Check if the indices are within bounds
     if (i >= get_rows() || j >= get_cols())
         return 0; // Out of bounds, return 0
@@ -436,41 +1524,38 @@ T algebra::SparseMatrix<T,Order>::operator()(std::size_t i, std::size_t j) const
     if (!compressed)
         return data.count({i, j}) ? data.at({i, j}) : 0;
     else {
-        // Compressed mode
-        // Determine the start and end indexes for the loop based on storage order and indices
-        const auto& idx = (Order == StorageOrder::RowMajor) ? first_indexes[i] : first_indexes[j];
-        const auto& endIdx = (Order == StorageOrder::RowMajor) ? first_indexes[i + 1] : first_indexes[j + 1];
-        // Search for the element within the compressed format
-        for (std::size_t k = idx; k < endIdx; ++k) {
-            if (second_indexes[k] == ((Order == StorageOrder::RowMajor) ? j : i)) {
-                return values[k]; // Element found, return its value
-            }
-        }
-        return 0; // Element not found, return default value
+        // Compressed mode: binary search in the sorted row (column)
+        const std::size_t k = find_compressed(i, j);
+        if (k != nnz())
+            return values_ptr()[k]; // Element found, return its value
+        SPARSE_COUNT(LookupMiss);
+        // Element inserted after compression and not merged yet
+        const auto it = pending.find({i, j});
+        return it != pending.end() ? it->second : 0; // Element not found, return default value
     }
 }
 
-// NOTICE: you cannot add a element in compressed state!!
-template<typename T, StorageOrder Order>
-T& algebra::SparseMatrix<T,Order>::operator()(std::size_t i, std::size_t j) {
+// NOTICE: in compressed state new elements go to a side buffer, merged by finalize()
+template<typename T, StorageOrder Order, typename Index>
+T& algebra::SparseMatrix<T, Order, Index>::operator()(std::size_t i, std::size_t j) {
     // Check if the indices are within bounds
     if (i >= get_rows() || j >= get_cols())
         throw std::out_of_range("Index out of range");
 
     // If the matrix is compressed
     if (compressed){
-        // Compressed mode
-        // Determine the start and end indexes for the loop based on storage order and indices
-        const auto& idx = (Order == StorageOrder::RowMajor) ? first_indexes[i] : first_indexes[j];
-        const auto& endIdx = (Order == StorageOrder::RowMajor) ? first_indexes[i + 1] : first_indexes[j + 1];
-        // Search for the element within the compressed format
-        for (std::size_t k = idx; k < endIdx; ++k) {
-            if (second_indexes[k] == ((Order == StorageOrder::RowMajor) ? j : i)) {
-                return values[k]; // Element found, return its value
-            }
+        // Compressed mode: binary search in the sorted row (column)
+        const std::size_t k = find_compressed(i, j);
+        if (k != nnz()) {
+            // The returned reference may be written: leave the memory-mapped file
+            detach();
+            return values[k]; // Element found, return its value
         }
-        // If element not found, throw an exception
-        throw std::out_of_range("Element not found");
+        // If element not found, insert it in the side buffer (merged in one batch by finalize())
+        SPARSE_COUNT(LookupMiss);
+        if (frozen)
+            throw std::out_of_range("Element not in the frozen pattern");
+        return pending[{i, j}];
     } else {
         // Uncompressed mode
         // Access the element in the data map, creating a new element with value 0 if not found
@@ -0,0 +1,248 @@
+#ifndef SYMMETRICSPARSEMATRIX_HPP
+#define SYMMETRICSPARSEMATRIX_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "MatrixMarket.hpp"
+#include "Parallel.hpp"
+#include "RowArrays.hpp"
+#include "SparseMatrix.hpp"
+
+namespace algebra // Algebra namespace
+{
+    // Triangle kept by a SymmetricSparseMatrix (the diagonal is always stored)
+    enum class Triangle {
+        Upper,
+        Lower
+    };
+
+    // Square matrix with symmetric, skew-symmetric or hermitian structure (mm::Symmetry) that stores only
+    // one triangle and the diagonal, in CSR (a RowMajor compressed SparseMatrix). The product applies every
+    // off-diagonal entry twice, to A_{i,j} and to its mirror A_{j,i}, so it reads half of the data of the
+    // full matrix. The matrix is read-only.
+    template <typename T, typename Index = std::size_t>
+    class SymmetricSparseMatrix {
+    private:
+        SparseMatrix<T, StorageOrder::RowMajor, Index> half;    // stored triangle with the diagonal
+        Triangle triangle = Triangle::Upper;
+        mm::Symmetry kind = mm::Symmetry::Symmetric;
+        std::size_t num_threads = 1;
+
+        // Mirrored values A_{j,i} from A_{i,j}
+        struct Same {
+            T operator()(const T& v) const { return v; }
+        };
+        struct Negated {
+            T operator()(const T& v) const { return -v; }
+        };
+        struct Conjugated {
+            T operator()(const T& v) const { return kernels::conj(v); }
+        };
+
+        // Keeps the entries of the stored triangle, mirroring those of the other one (duplicates are summed)
+        void build(std::size_t n, std::vector<std::size_t>& rows, std::vector<std::size_t>& cols, std::vector<T>& vals) {
+            for (std::size_t k = 0; k < vals.size(); ++k) {
+                const bool upper = rows[k] <= cols[k];
+                const bool lower = rows[k] >= cols[k];
+                if ((triangle == Triangle::Upper && !upper) || (triangle == Triangle::Lower && !lower)) {
+                    std::swap(rows[k], cols[k]);
+                    vals[k] = mm::detail::mirror_value(vals[k], kind);
+                }
+            }
+            half.compress_from_triplets(n, n, rows, cols, vals);
+        }
+
+        // Adds the product of the rows [begin, end) to out, where out[r - offset] is the entry r of the result
+        template <typename Mirror>
+        void multiply_rows(const T* x, T* out, std::size_t offset, std::size_t begin, std::size_t end, Mirror mirror) const {
+            const Index* outer = half.outer_indexes();
+            const Index* inner = half.inner_indexes();
+            const T* vals = half.values_data();
+            for (std::size_t i = begin; i < end; ++i) {
+                const T xi = x[i];
+                T sum = 0;
+                for (std::size_t k = outer[i]; k < outer[i + 1]; ++k) {
+                    const std::size_t j = inner[k];
+                    sum += vals[k] * x[j];
+                    if (j != i)
+                        out[j - offset] += mirror(vals[k]) * xi;
+                }
+                out[i - offset] += sum;
+            }
+        }
+
+        template <typename Mirror>
+        void multiply_with(const T* x, T* y, std::size_t threads, Mirror mirror) const {
+            const std::size_t n = half.get_rows();
+            std::fill(y, y + n, T(0));
+            const std::size_t parts = std::max<std::size_t>(1, std::min(threads, n));
+            if (parts == 1) {
+                multiply_rows(x, y, 0, 0, n, mirror);
+                return;
+            }
+            // Conflict-free parallel product: every thread owns a block of rows (same number of stored
+            // entries) and accumulates into a private buffer that covers only the rows its entries can touch,
+            // [lowest column, highest column] of its block. Buffers are short for banded matrices (e.g.
+            // after a bandwidth-reducing reordering). Then every thread sums, for its own block of the
+            // result, the overlapping parts of the buffers, always in the same order.
+            const Index* outer = half.outer_indexes();
+            const Index* inner = half.inner_indexes();
+            const auto bounds = parallel::balanced_partition(outer, n, parts);
+            std::vector<std::size_t> lo(parts), hi(parts);
+            std::vector<std::vector<T>> buffer(parts);
+            parallel::run(parts, [&](std::size_t t) {
+                std::size_t first = bounds[t], last = bounds[t + 1];
+                for (std::size_t i = bounds[t]; i < bounds[t + 1]; ++i) {
+                    if (outer[i] != outer[i + 1]) {
+                        // Columns are sorted inside every row
+                        first = std::min<std::size_t>(first, inner[outer[i]]);
+                        last = std::max<std::size_t>(last, static_cast<std::size_t>(inner[outer[i + 1] - 1]) + 1);
+                    }
+                }
+                lo[t] = first;
+                hi[t] = last;
+                buffer[t].assign(last - first, T(0));
+                multiply_rows(x, buffer[t].data(), first, bounds[t], bounds[t + 1], mirror);
+            });
+            parallel::for_range(n, parts, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t t = 0; t < parts; ++t) {
+                    const std::size_t from = std::max(begin, lo[t]);
+                    const std::size_t to = std::min(end, hi[t]);
+                    for (std::size_t r = from; r < to; ++r)
+                        y[r] += buffer[t][r - lo[t]];
+                }
+            });
+        }
+
+    public:
+        // Empty matrix
+        SymmetricSparseMatrix() = default;
+
+        // Reads a symmetric, skew-symmetric or hermitian Matrix Market file without expanding it: only the
+        // entries written in the file are read, and they are moved to the requested triangle. threads is used
+        // to parse the file and by the products. Throws std::runtime_error on errors or if the banner declares
+        // a general matrix
+        explicit SymmetricSparseMatrix(const std::string& filename, Triangle tri = Triangle::Upper,
+                                       std::size_t threads = parallel::hardware_threads())
+            : triangle(tri), num_threads(std::max<std::size_t>(threads, 1)) {
+            mm::Triplets<T> triplets = mm::read<T>(filename, threads, false);
+            if (triplets.header.symmetry == mm::Symmetry::General)
+                throw std::runtime_error("Matrix Market file without symmetry: " + filename);
+            if (triplets.header.rows != triplets.header.cols)
+                throw std::runtime_error("Symmetric Matrix Market file of a non-square matrix: " + filename);
+            kind = triplets.header.symmetry;
+            build(triplets.header.rows, triplets.rows, triplets.cols, triplets.values);
+        }
+
+        // Keeps one triangle of a compressed square matrix, after checking that every entry matches its
+        // mirror according to the symmetry. Throws std::invalid_argument if it does not
+        template <StorageOrder Order>
+        explicit SymmetricSparseMatrix(const SparseMatrix<T, Order, Index>& A, Triangle tri = Triangle::Upper,
+                                       mm::Symmetry symmetry = mm::Symmetry::Symmetric)
+            : triangle(tri), kind(symmetry), num_threads(A.get_num_threads()) {
+            if (symmetry == mm::Symmetry::General)
+                throw std::invalid_argument("SymmetricSparseMatrix: the symmetry cannot be general");
+            if (A.get_rows() != A.get_cols())
+                throw std::invalid_argument("SymmetricSparseMatrix: the matrix must be square");
+            const RowArrays<T, Index> csr(A);
+            const std::size_t n = A.get_rows();
+            std::vector<std::size_t> rows, cols;
+            std::vector<T> vals;
+            for (std::size_t i = 0; i < n; ++i) {
+                for (std::size_t k = csr.outer[i]; k < csr.outer[i + 1]; ++k) {
+                    const std::size_t j = csr.inner[k];
+                    // The mirror A_{j,i} is searched in row j (missing entries are zeros)
+                    const Index* first = csr.inner + csr.outer[j];
+                    const Index* last = csr.inner + csr.outer[j + 1];
+                    const Index* it = std::lower_bound(first, last, static_cast<Index>(i));
+                    const T mirrored = (it != last && *it == i) ? csr.values[it - csr.inner] : T(0);
+                    if (mirrored != mm::detail::mirror_value(csr.values[k], symmetry))
+                        throw std::invalid_argument("SymmetricSparseMatrix: the matrix is not symmetric at (" + std::to_string(i) + ", " +
+                                                    std::to_string(j) + ")");
+                    if ((tri == Triangle::Upper && i <= j) || (tri == Triangle::Lower && i >= j)) {
+                        rows.push_back(i);
+                        cols.push_back(j);
+                        vals.push_back(csr.values[k]);
+                    }
+                }
+            }
+            half.compress_from_triplets(n, n, rows, cols, vals);
+        }
+
+        std::size_t get_rows() const {
+            return half.get_rows();
+        }
+
+        std::size_t get_cols() const {
+            return half.get_cols();
+        }
+
+        // Number of stored entries (one triangle and the diagonal)
+        std::size_t get_nnz() const {
+            return half.get_nnz();
+        }
+
+        // Number of non-zeros of the full matrix
+        std::size_t full_nnz() const {
+            const Index* outer = half.outer_indexes();
+            const Index* inner = half.inner_indexes();
+            std::size_t diagonal = 0;
+            for (std::size_t i = 0; i < half.get_rows(); ++i)
+                for (std::size_t k = outer[i]; k < outer[i + 1]; ++k)
+                    diagonal += (inner[k] == i);
+            return 2 * half.get_nnz() - diagonal;
+        }
+
+        Triangle stored_triangle() const {
+            return triangle;
+        }
+
+        mm::Symmetry symmetry() const {
+            return kind;
+        }
+
+        // Stored triangle as a compressed RowMajor matrix (e.g. to save it with save_binary)
+        const SparseMatrix<T, StorageOrder::RowMajor, Index>& storage() const {
+            return half;
+        }
+
+        // Method to set the number of threads used by operator* (1 means serial)
+        void set_num_threads(std::size_t threads) {
+            num_threads = std::max<std::size_t>(threads, 1);
+        }
+
+        std::size_t get_num_threads() const {
+            return num_threads;
+        }
+
+        // y = A*x without allocating the result (y has get_rows() entries)
+        void multiply_into(std::vector<T>& y, const std::vector<T>& x, std::size_t threads) const {
+            if (x.size() != get_cols() || y.size() != get_rows())
+                throw std::invalid_argument("SymmetricSparseMatrix: vector sizes do not match the matrix");
+            if (kind == mm::Symmetry::SkewSymmetric)
+                multiply_with(x.data(), y.data(), threads, Negated());
+            else if (kind == mm::Symmetry::Hermitian)
+                multiply_with(x.data(), y.data(), threads, Conjugated());
+            else
+                multiply_with(x.data(), y.data(), threads, Same());
+        }
+
+        // Matrix-vector product with an explicit number of threads
+        std::vector<T> multiply(const std::vector<T>& x, std::size_t threads) const {
+            std::vector<T> y(get_rows());
+            multiply_into(y, x, threads);
+            return y;
+        }
+
+        friend std::vector<T> operator*(const SymmetricSparseMatrix& M, const std::vector<T>& x) {
+            return M.multiply(x, M.num_threads);
+        }
+    };
+
+}   // namespace algebra
+
+#endif  // SYMMETRICSPARSEMATRIX_HPP
@@ -1,9 +1,18 @@
 #include "SparseMatrix.hpp"
+#include "Solvers.hpp"
+#include "SellMatrix.hpp"
+#include "BlockSparseMatrix.hpp"
+#include "SymmetricSparseMatrix.hpp"
+#include "Reordering.hpp"
+#include "SpGEMM.hpp"
+#include "Arithmetic.hpp"
+#include "MixedPrecisionMatrix.hpp"
+#include "ConcurrentAssembler.hpp"
 #include "chrono.hpp"
 
 // Function to test matrix-vector multiplication and measure time
-template<typename T, StorageOrder Order>
-double testMatrixVectorMultiplication(const algebra::SparseMatrix<T, Order>& matrix, const std::vector<T>& vec) {
+template<typename T, StorageOrder Order, typename Index>
+double testMatrixVectorMultiplication(const algebra::SparseMatrix<T, Order, Index>& matrix, const std::vector<T>& vec) {
     Timings::Chrono chronometer;
     chronometer.start();
     std::vector<T> result = matrix * vec;
@@ -12,6 +21,10 @@ double testMatrixVectorMultiplication(const algebra::SparseMatrix<T, Order>& mat
 }
 
 int main() {
+    // Progress messages of the library on the console (the default level only reports warnings and errors)
+    algebra::instrumentation::set_log_level(algebra::instrumentation::LogLevel::Info);
+    algebra::instrumentation::set_log_stream(std::cout);
+
     // TEST 1: Create Sparse Matrix using uncompressed storage technique
     {
         algebra::SparseMatrix<double, StorageOrder::RowMajor> mat(4, 4, false);
@@ -63,5 +76,578 @@ int main() {
         std::cout << "Time for compressed multiplication: " << time_compressed << " msec" << std::endl;
     }
 
+    // TEST 4: Multithreaded matrix-vector multiplication (CSR)
+    {
+        std::string filename = "Insp_131.mtx";
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> mat3(filename, false);
+        std::vector<double> vec(mat3.get_cols());
+        for (std::size_t i = 0; i < vec.size(); ++i)
+            vec[i] = 1.0 + static_cast<double>(i % 7);
+
+        mat3.compress();
+        std::vector<double> serial = mat3 * vec;
+
+        // A fixed number of threads, so that the parallel path runs even on a single core
+        const std::size_t threads = 4;
+        mat3.set_num_threads(threads);
+        std::vector<double> parallel = mat3 * vec;
+        double time_parallel = testMatrixVectorMultiplication(mat3, vec);
+
+        std::cout << "Time for compressed multiplication with " << threads << " threads: " << time_parallel << " usec" << std::endl;
+        std::cout << "Parallel result equal to serial one: " << std::boolalpha << (serial == parallel) << std::endl;
+    }
+
+    // TEST 5: Multithreaded matrix-vector multiplication (CSC)
+    {
+        std::string filename = "Insp_131.mtx";
+        algebra::SparseMatrix<double, StorageOrder::ColumnMajor> mat4(filename, false);
+        std::vector<double> vec(mat4.get_cols());
+        for (std::size_t i = 0; i < vec.size(); ++i)
+            vec[i] = 1.0 + static_cast<double>(i % 7);
+
+        mat4.compress();
+        std::vector<double> serial = mat4 * vec;
+        std::cout << "Time for CSC multiplication with 1 thread: " << testMatrixVectorMultiplication(mat4, vec) << " usec" << std::endl;
+
+        // Fixed numbers of threads: 4 threads use private copies of the result, 16 threads split the rows
+        // of the result in blocks (see scatter_product). Every product is timed after a first call
+        double max_diff = 0;
+        for (const std::size_t threads : {4, 16}) {
+            mat4.set_num_threads(threads);
+            std::vector<double> parallel = mat4 * vec;
+            for (std::size_t i = 0; i < serial.size(); ++i)
+                max_diff = std::max(max_diff, std::abs(serial[i] - parallel[i]));
+            std::cout << "Time for CSC multiplication with " << threads << " threads: " << testMatrixVectorMultiplication(mat4, vec) << " usec" << std::endl;
+        }
+        std::cout << "Max difference from the serial result: " << max_diff << std::endl;
+    }
+
+    // TEST 6: Compressed matrix with 32-bit indexes
+    {
+        std::string filename = "Insp_131.mtx";
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> mat64(filename, false);
+        algebra::SparseMatrix<double, StorageOrder::RowMajor, std::uint32_t> mat32(filename, false);
+        std::vector<double> vec(mat64.get_cols());
+        for (std::size_t i = 0; i < vec.size(); ++i)
+            vec[i] = 1.0 + static_cast<double>(i % 7);
+
+        mat64.compress();
+        mat32.compress();
+        double time_64 = testMatrixVectorMultiplication(mat64, vec);
+        double time_32 = testMatrixVectorMultiplication(mat32, vec);
+
+        std::cout << "Time for multiplication with 64-bit indexes: " << time_64 << " usec" << std::endl;
+        std::cout << "Time for multiplication with 32-bit indexes: " << time_32 << " usec" << std::endl;
+        std::cout << "Same result: " << std::boolalpha << ((mat64 * vec) == (mat32 * vec)) << std::endl;
+    }
+
+    // TEST 7: Save and load (memory-mapped, zero-copy) a compressed matrix in binary format
+    {
+        std::string filename = "Insp_131.mtx";
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> mat5(filename, true);
+        mat5.save_binary("Insp_131.bin");
+
+        Timings::Chrono chronometer;
+        chronometer.start();
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> mat6;
+        mat6.load_binary("Insp_131.bin");
+        chronometer.stop();
+
+        std::vector<double> vec(mat5.get_cols(), 1.0);
+        std::cout << "Time for loading the binary file: " << chronometer.wallTime() << " usec" << std::endl;
+        std::cout << "Same result: " << std::boolalpha << ((mat5 * vec) == (mat6 * vec)) << std::endl;
+
+        // A column index out of range in the file is rejected at load time
+        std::ifstream in("Insp_131.bin", std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        algebra::binary::Header header;
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        const std::size_t bad_column = 1000000;
+        std::memcpy(&bytes[header.second_offset], &bad_column, sizeof(bad_column));
+        std::ofstream("Insp_131_corrupted.bin", std::ios::binary) << bytes;
+        try {
+            mat6.load_binary("Insp_131_corrupted.bin");
+            std::cout << "Corrupted file accepted" << std::endl;
+        } catch (const std::runtime_error& e) {
+            std::cout << "Corrupted file rejected: " << e.what() << std::endl;
+        }
+    }
+
+    // TEST 8: Contributions added with add() are dropped when the content of the matrix is replaced
+    {
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> from_triplets(3, 3);
+        from_triplets.add(0, 0, 100.0);
+        from_triplets.compress_from_triplets(3, 3, {1}, {1}, {5.0});
+        from_triplets.uncompress();
+        from_triplets.compress();
+
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> assigned(3, 3);
+        assigned.add(0, 0, 100.0);
+        assigned.assign_compressed(3, 3, {0, 0, 1, 1}, {1}, {5.0});
+        assigned.uncompress();
+        assigned.compress();
+
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> loaded(3, 3);
+        loaded.add(2, 2, 7.0);
+        loaded.load_binary("Insp_131.bin");
+        loaded.uncompress();
+        loaded.compress();
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> reference;
+        reference.load_binary("Insp_131.bin");
+        const std::vector<double> ones(reference.get_cols(), 1.0), ones3(3, 1.0), expected = {0.0, 5.0, 0.0};
+
+        std::cout << "Stale contributions dropped: " << std::boolalpha
+                  << ((from_triplets * ones3) == expected &&
+                      (assigned * ones3) == expected &&
+                      (loaded * ones) == (reference * ones))
+                  << std::endl;
+    }
+
+    // TEST 9: Elements inserted in a compressed matrix (side buffer) before and after finalize()
+    {
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> compressed("Insp_131.mtx", true);
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> uncompressed("Insp_131.mtx", false);
+        const std::size_t rows = compressed.get_rows(), cols = compressed.get_cols();
+        for (std::size_t i = 0; i < rows; i += 3) {
+            const std::size_t j = (7 * i + 5) % cols;
+            compressed(i, j) += 1.5;
+            uncompressed(i, j) += 1.5;
+        }
+        const std::size_t inserted = compressed.pending_size();
+
+        std::vector<double> x(cols);
+        for (std::size_t j = 0; j < cols; ++j)
+            x[j] = 1.0 + static_cast<double>(j % 5);
+        const std::vector<double> expected = uncompressed * x;
+        const std::vector<double> before = compressed * x;
+        compressed.finalize();
+        const std::vector<double> after = compressed * x;
+
+        double max_diff = 0;
+        for (std::size_t i = 0; i < rows; ++i)
+            max_diff = std::max({max_diff, std::abs(before[i] - expected[i]), std::abs(after[i] - expected[i])});
+        std::cout << "Elements in the side buffer: " << inserted << ", after finalize: " << compressed.pending_size()
+                  << ", max difference " << max_diff << std::endl;
+    }
+
+    // TEST 10: Values refreshed in a frozen pattern through the slots and a scatter plan
+    {
+        // Two-node elements of a 1D mesh: every element contributes c*[1 -1; -1 1]
+        const std::size_t n = 200;
+        std::vector<std::array<std::size_t, 2>> positions;
+        for (std::size_t e = 0; e + 1 < n; ++e)
+            for (std::size_t a = 0; a < 2; ++a)
+                for (std::size_t b = 0; b < 2; ++b)
+                    positions.push_back({e + a, e + b});
+
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> pattern(n, n);
+        for (const auto& p : positions)
+            pattern.add(p[0], p[1], 0.0);
+        pattern.compress();
+        pattern.freeze_pattern();
+        const std::vector<std::size_t> slots = pattern.slots(positions);
+        const auto plan = pattern.make_scatter_plan(slots);
+
+        // Refresh the values with a new coefficient per element, plus a boundary term through a slot
+        std::vector<double> contributions(positions.size());
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> assembled(n, n);
+        for (std::size_t k = 0; k < positions.size(); ++k) {
+            const double c = 1.0 + static_cast<double>(k / 4 % 3);
+            contributions[k] = (positions[k][0] == positions[k][1]) ? c : -c;
+            assembled.add(positions[k][0], positions[k][1], contributions[k]);
+        }
+        assembled.add(0, 0, 10.0);
+        assembled.compress();
+        pattern.set_zero();
+        pattern.scatter_add(plan, contributions, 4);
+        pattern.value_at(pattern.slot(0, 0)) += 10.0;
+
+        std::vector<double> x(n);
+        for (std::size_t i = 0; i < n; ++i)
+            x[i] = static_cast<double>(i % 9);
+        const std::vector<double> y = pattern * x, z = assembled * x;
+        double max_diff = 0;
+        for (std::size_t i = 0; i < n; ++i)
+            max_diff = std::max(max_diff, std::abs(y[i] - z[i]));
+
+        bool rejected = false;
+        try {
+            pattern(0, n - 1) = 1.0;
+        } catch (const std::out_of_range&) {
+            rejected = true;
+        }
+        // The plan no longer matches the matrix once it is uncompressed
+        bool stale_rejected = false;
+        pattern.uncompress();
+        try {
+            pattern.scatter_add(plan, contributions, 4);
+        } catch (const std::invalid_argument&) {
+            stale_rejected = true;
+        }
+        std::cout << "Frozen pattern refresh, max difference " << max_diff << ", insertion outside the pattern rejected: "
+                  << std::boolalpha << rejected << ", stale plan rejected: " << stale_rejected << std::endl;
+    }
+
+    // TEST 11: Product with a block of 8 vectors against 8 separate matrix-vector products
+    {
+        std::string filename = "Insp_131.mtx";
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> mat7(filename, true);
+        const std::size_t k = 8;
+        std::vector<double> X(mat7.get_cols() * k);
+        for (std::size_t i = 0; i < X.size(); ++i)
+            X[i] = static_cast<double>(i % 7);
+
+        Timings::Chrono chronometer;
+        chronometer.start();
+        std::vector<double> Y = mat7.multiply_block(X, k);
+        chronometer.stop();
+        std::cout << "Time for the product with " << k << " vectors: " << chronometer.wallTime() << " usec" << std::endl;
+
+        std::vector<std::vector<double>> columns(k, std::vector<double>(mat7.get_cols()));
+        for (std::size_t c = 0; c < k; ++c)
+            for (std::size_t j = 0; j < mat7.get_cols(); ++j)
+                columns[c][j] = X[j * k + c];
+
+        std::vector<std::vector<double>> products(k);
+        chronometer.start();
+        for (std::size_t c = 0; c < k; ++c)
+            products[c] = mat7 * columns[c];
+        chronometer.stop();
+
+        double max_diff = 0;
+        for (std::size_t c = 0; c < k; ++c)
+            for (std::size_t i = 0; i < products[c].size(); ++i)
+                max_diff = std::max(max_diff, std::abs(products[c][i] - Y[i * k + c]));
+        std::cout << "Time for " << k << " separate products: " << chronometer.wallTime() << " usec, max difference: " << max_diff << std::endl;
+    }
+
+    // TEST 12: Fused products (alpha, beta, transpose, inner product) against operator*
+    {
+        const algebra::SparseMatrix<double, StorageOrder::RowMajor> csr("Insp_131.mtx", true), map_csr("Insp_131.mtx", false);
+        const algebra::SparseMatrix<double, StorageOrder::ColumnMajor> csc("Insp_131.mtx", true), map_csc("Insp_131.mtx", false);
+        const std::size_t n = csr.get_rows();
+
+        std::vector<double> x(n), y0(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            x[i] = 1.0 + static_cast<double>(i % 4);
+            y0[i] = static_cast<double>(i % 3) - 1.0;
+        }
+        // Reference for the transposed product, element by element
+        const std::vector<double> Ax = csr * x;
+        std::vector<double> Atx(n, 0.0);
+        for (std::size_t i = 0; i < n; ++i)
+            for (std::size_t j = 0; j < n; ++j)
+                Atx[j] += csr(i, j) * x[i];
+        const std::vector<std::array<double, 2>> coefficients = {{1.0, 0.0}, {2.0, 0.0}, {1.0, 1.0}, {-0.5, 3.0}};
+
+        double max_diff = 0;
+        const auto check = [&](const auto& M) {
+            for (const auto& c : coefficients) {
+                const double alpha = c[0], beta = c[1];
+                std::vector<double> y = y0, yt = y0, yd = y0;
+                M.multiply_into(y, x, alpha, beta);
+                M.multiply_transpose_into(yt, x, alpha, beta);
+                const double dot = M.multiply_into_dot(yd, x, alpha, beta);
+                double expected_dot = 0;
+                for (std::size_t i = 0; i < n; ++i) {
+                    const double expected = alpha * Ax[i] + beta * y0[i];
+                    max_diff = std::max({max_diff, std::abs(y[i] - expected), std::abs(yd[i] - expected),
+                                         std::abs(yt[i] - (alpha * Atx[i] + beta * y0[i]))});
+                    expected_dot += x[i] * expected;
+                }
+                max_diff = std::max(max_diff, std::abs(dot - expected_dot) / std::abs(expected_dot));
+            }
+        };
+        check(csr);
+        check(map_csr);
+        check(csc);
+        check(map_csc);
+        std::cout << "Fused products (CSR, CSC, compressed and not, 4 alpha/beta pairs), max difference: " << max_diff << std::endl;
+    }
+
+    // TEST 13: Solution of a linear system with the Krylov solvers (the matrix is not symmetric)
+    {
+        std::string filename = "Insp_131.mtx";
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> mat8(filename, true);
+        std::vector<double> solution(mat8.get_cols(), 1.0);
+        std::vector<double> rhs = mat8 * solution;
+
+        algebra::solvers::Options options;
+        options.restart = 50;
+        std::vector<double> x;
+        algebra::solvers::GMRES<double> gmres(options);
+        std::cout << gmres.solve(mat8, rhs, x) << std::endl;
+    }
+
+    // TEST 14: SELL-C-sigma copy of a compressed matrix, padding overhead and product time
+    {
+        std::string filename = "Insp_131.mtx";
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> mat9(filename, true);
+        algebra::SellMatrix<double> sell(mat9, 8, 256);
+        std::vector<double> vec(mat9.get_cols(), 1.0);
+        std::cout << "SELL-" << sell.chunk_height() << "-" << sell.sorting_window() << " padding: " << 100 * sell.padding_ratio() << "%" << std::endl;
+        std::cout << "Time for CSR multiplication: " << testMatrixVectorMultiplication(mat9, vec) << " usec" << std::endl;
+
+        Timings::Chrono chronometer;
+        chronometer.start();
+        std::vector<double> result = sell * vec;
+        chronometer.stop();
+        std::cout << "Time for SELL multiplication: " << chronometer.wallTime() << " usec" << std::endl;
+        // The sums of a row are done in a different order than in the CSR kernel
+        std::vector<double> reference = mat9 * vec;
+        double max_diff = 0;
+        for (std::size_t i = 0; i < result.size(); ++i)
+            max_diff = std::max(max_diff, std::abs(result[i] - reference[i]));
+        std::cout << "Max difference from the CSR result: " << max_diff << std::endl;
+    }
+
+    // TEST 15: Block size detection and BCSR product
+    {
+        std::string filename = "Insp_131.mtx";
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> mat10(filename, true);
+        for (std::size_t b = 2; b <= 4; ++b)
+            std::cout << "Fill ratio of " << b << "x" << b << " blocks: " << algebra::block_fill_ratio(mat10, b, b) << std::endl;
+        const algebra::BlockSize size = algebra::detect_block_size(mat10);
+        std::cout << "Detected block size: " << size.rows << "x" << size.cols << std::endl;
+
+        algebra::BCSR2<double> bcsr(mat10);
+        std::vector<double> vec(mat10.get_cols(), 1.0);
+        std::vector<double> result = bcsr * vec;
+        std::vector<double> reference = mat10 * vec;
+        double max_diff = 0;
+        for (std::size_t i = 0; i < result.size(); ++i)
+            max_diff = std::max(max_diff, std::abs(result[i] - reference[i]));
+        std::cout << "BCSR 2x2 blocks: " << bcsr.num_blocks() << ", max difference from the CSR result: " << max_diff << std::endl;
+    }
+
+    // TEST 16: Symmetric storage (upper triangle) of a tridiagonal matrix
+    {
+        const std::size_t n = 1000;
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> mat11(n, n);
+        for (std::size_t i = 0; i < n; ++i) {
+            mat11.add(i, i, 2.0);
+            if (i > 0)
+                mat11.add(i, i - 1, -1.0);
+            if (i + 1 < n)
+                mat11.add(i, i + 1, -1.0);
+        }
+        mat11.compress();
+        algebra::SymmetricSparseMatrix<double> sym(mat11, algebra::Triangle::Upper);
+        std::cout << "Stored entries: " << sym.get_nnz() << " of " << sym.full_nnz() << std::endl;
+
+        std::vector<double> vec(n, 1.0);
+        std::cout << "Same result: " << std::boolalpha << (sym * vec == mat11 * vec) << std::endl;
+    }
+
+    // TEST 17: Reverse Cuthill-McKee reordering of a 2D Laplacian with scrambled numbering
+    {
+        const std::size_t m = 300, n = m * m;
+        // Vertex i of the grid gets number (i * 7919) % n, as on an unstructured mesh
+        auto number = [n](std::size_t i) { return (i * 7919) % n; };
+        std::vector<std::size_t> rows, cols;
+        std::vector<double> values;
+        for (std::size_t a = 0; a < m; ++a) {
+            for (std::size_t b = 0; b < m; ++b) {
+                const std::size_t i = a * m + b;
+                auto add = [&](std::size_t j, double v) {
+                    rows.push_back(number(i));
+                    cols.push_back(number(j));
+                    values.push_back(v);
+                };
+                add(i, 4.0);
+                if (a > 0) add(i - m, -1.0);
+                if (a + 1 < m) add(i + m, -1.0);
+                if (b > 0) add(i - 1, -1.0);
+                if (b + 1 < m) add(i + 1, -1.0);
+            }
+        }
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> mat12;
+        mat12.compress_from_triplets(n, n, rows, cols, values);
+
+        const algebra::reordering::Permutation perm = algebra::reordering::rcm(mat12);
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> reordered = algebra::reordering::permute(mat12, perm);
+        std::cout << "Bandwidth: " << algebra::reordering::bandwidth(mat12) << " -> " << algebra::reordering::bandwidth(reordered)
+                  << ", profile: " << algebra::reordering::profile(mat12) << " -> " << algebra::reordering::profile(reordered) << std::endl;
+
+        std::vector<double> vec(n, 1.0);
+        std::vector<double> vec_reordered = algebra::reordering::permute_vector(vec, perm);
+        // Average of 20 products, after a first one that brings the matrix into the cache
+        auto average_time = [](const auto& matrix, const std::vector<double>& x) {
+            double total = 0;
+            testMatrixVectorMultiplication(matrix, x);
+            for (int k = 0; k < 20; ++k)
+                total += testMatrixVectorMultiplication(matrix, x);
+            return total / 20;
+        };
+        std::cout << "Time for multiplication, original numbering: " << average_time(mat12, vec) << " usec" << std::endl;
+        std::cout << "Time for multiplication, RCM numbering: " << average_time(reordered, vec_reordered) << " usec" << std::endl;
+        std::vector<double> result = algebra::reordering::unpermute_vector(reordered * vec_reordered, perm);
+        std::cout << "Same result: " << std::boolalpha << (result == mat12 * vec) << std::endl;
+    }
+
+    // TEST 18: Sparse matrix-matrix product with operands in different storage orders
+    {
+        std::string filename = "Insp_131.mtx";
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> mat13(filename, true);
+        algebra::SparseMatrix<double, StorageOrder::ColumnMajor> mat14(filename, true);
+
+        Timings::Chrono chronometer;
+        chronometer.start();
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> product = mat13 * mat14;
+        chronometer.stop();
+        std::cout << "Time for the sparse product: " << chronometer.wallTime() << " usec, non-zeros: " << product.get_nnz() << std::endl;
+
+        std::vector<double> vec(mat13.get_cols());
+        for (std::size_t i = 0; i < vec.size(); ++i)
+            vec[i] = 1.0 + static_cast<double>(i % 7);
+        std::vector<double> result = product * vec;
+        std::vector<double> reference = mat13 * (mat14 * vec);
+        // The entries of the matrix reach 1e9: the difference is relative to the largest entry of the result
+        double max_diff = 0, max_entry = 0;
+        for (std::size_t i = 0; i < result.size(); ++i) {
+            max_diff = std::max(max_diff, std::abs(result[i] - reference[i]));
+            max_entry = std::max(max_entry, std::abs(reference[i]));
+        }
+        std::cout << "Max relative difference from two matrix-vector products: " << max_diff / max_entry << std::endl;
+    }
+
+    // TEST 19: Arithmetic on the compressed vectors (norms, linear combinations, diagonal shift)
+    {
+        std::string filename = "Insp_131.mtx";
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> mat15(filename, true);
+        algebra::SparseMatrix<double, StorageOrder::ColumnMajor> mat16(filename, true);
+        std::cout << "Norms: 1 = " << algebra::norm_one(mat15) << ", inf = " << algebra::norm_inf(mat15)
+                  << ", Frobenius = " << algebra::norm_frobenius(mat15) << std::endl;
+
+        // Same matrix in the two storage orders: the difference has the same pattern and zero values
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> difference = mat15 - mat16;
+        std::cout << "Non-zeros of A - A: " << difference.get_nnz() << ", norm: " << algebra::norm_frobenius(difference) << std::endl;
+
+        // A = 2*A - A in place: same pattern, no allocation
+        algebra::axpby_in_place(2.0, mat15, -1.0, mat16);
+        algebra::shift_diagonal(mat15, 1.0);
+        std::vector<double> diag = algebra::diagonal(mat15);
+        std::vector<double> reference = algebra::diagonal(mat16);
+        double max_diff = 0;
+        for (std::size_t i = 0; i < diag.size(); ++i)
+            max_diff = std::max(max_diff, std::abs(diag[i] - reference[i] - 1.0));
+        std::cout << "Non-zeros after the diagonal shift: " << mat15.get_nnz() << ", max difference of the diagonal: " << max_diff << std::endl;
+    }
+
+    // TEST 20: Gauss-Seidel sweeps with zero-copy row views, iteration over the non-zeros
+    {
+        const std::size_t n = 100;
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> mat17(n, n);
+        for (std::size_t i = 0; i < n; ++i) {
+            mat17.add(i, i, 4.0);
+            if (i > 0)
+                mat17.add(i, i - 1, -1.0);
+            if (i + 1 < n)
+                mat17.add(i, i + 1, -1.0);
+        }
+        mat17.compress();
+        const std::size_t off_diagonal = std::count_if(mat17.begin(), mat17.end(), [](const auto& e) { return e.row != e.col; });
+        std::cout << "Off-diagonal non-zeros: " << off_diagonal << std::endl;
+
+        std::vector<double> rhs(n, 1.0), x(n, 0.0);
+        for (int sweep = 0; sweep < 10; ++sweep) {
+            for (std::size_t i = 0; i < n; ++i) {
+                const auto row = mat17.row(i);
+                double sum = rhs[i];
+                for (std::size_t k = 0; k < row.size(); ++k)
+                    if (row.indexes[k] != i)
+                        sum -= row.values[k] * x[row.indexes[k]];
+                x[i] = sum / row.values[row.find(i)];
+            }
+        }
+        std::vector<double> residual = mat17 * x;
+        double max_residual = 0;
+        for (std::size_t i = 0; i < n; ++i)
+            max_residual = std::max(max_residual, std::abs(rhs[i] - residual[i]));
+        std::cout << "Residual after 10 Gauss-Seidel sweeps: " << max_residual << std::endl;
+    }
+
+    // TEST 21: Library timers and counters of a few operations (build with make INSTRUMENT=1)
+    {
+        algebra::instrumentation::set_log_level(algebra::instrumentation::LogLevel::Warning);
+        algebra::instrumentation::reset();
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> mat18("Insp_131.mtx", true);
+        const std::vector<double> x(mat18.get_cols(), 1.0);
+        for (int k = 0; k < 100; ++k)
+            testMatrixVectorMultiplication(mat18, x);
+        for (std::size_t i = 0; i < 10; ++i)
+            std::as_const(mat18)(i, mat18.get_cols() - 1 - i);
+        mat18.uncompress();
+        mat18.compress();
+        algebra::instrumentation::dump(std::cout);
+    }
+
+    // TEST 22: Matrix-vector product with values stored in float and bfloat16, accumulated in double
+    {
+        algebra::SparseMatrix<double, StorageOrder::ColumnMajor> mat19("Insp_131.mtx", true);
+        const algebra::MixedPrecisionMatrix<float> single(mat19);
+        const algebra::MixedPrecisionMatrix<algebra::bfloat16> brain(mat19);
+        std::vector<double> x(mat19.get_cols());
+        for (std::size_t j = 0; j < x.size(); ++j)
+            x[j] = 1.0 + static_cast<double>(j % 5);
+        const std::vector<double> exact = mat19 * x;
+        auto relative_error = [&](const std::vector<double>& y) {
+            double diff = 0, norm = 0;
+            for (std::size_t i = 0; i < y.size(); ++i) {
+                diff = std::max(diff, std::abs(y[i] - exact[i]));
+                norm = std::max(norm, std::abs(exact[i]));
+            }
+            return diff / norm;
+        };
+        const std::size_t double_bytes = (mat19.get_cols() + 1 + mat19.get_nnz()) * sizeof(std::size_t) + mat19.get_nnz() * sizeof(double);
+        std::cout << "Bytes of the matrix: double " << double_bytes << ", float " << single.memory_bytes() << ", bfloat16 "
+                  << brain.memory_bytes() << std::endl;
+        std::cout << "Relative difference of the product: float " << relative_error(single * x) << ", bfloat16 "
+                  << relative_error(brain * x) << std::endl;
+    }
+
+    // TEST 23: Finite element assembly (bilinear elements on a 200x200 grid) from several threads
+    {
+        const std::size_t m = 200, n = (m + 1) * (m + 1);
+        const double local_matrix[4][4] = {{4, -1, -1, -2}, {-1, 4, -2, -1}, {-1, -2, 4, -1}, {-2, -1, -1, 4}};
+        auto element_nodes = [&](std::size_t e) {
+            const std::size_t a = e / m, b = e % m;
+            return std::array<std::size_t, 4>{a * (m + 1) + b, a * (m + 1) + b + 1, (a + 1) * (m + 1) + b, (a + 1) * (m + 1) + b + 1};
+        };
+
+        algebra::ConcurrentAssembler<double, StorageOrder::RowMajor> assembler(n, n, 4);
+        Timings::Chrono chronometer;
+        chronometer.start();
+        algebra::parallel::run(assembler.slots(), [&](std::size_t t) {
+            auto& local = assembler.local(t);
+            for (std::size_t e = m * m * t / assembler.slots(); e < m * m * (t + 1) / assembler.slots(); ++e) {
+                const auto nodes = element_nodes(e);
+                for (std::size_t i = 0; i < 4; ++i)
+                    for (std::size_t j = 0; j < 4; ++j)
+                        local.add(nodes[i], nodes[j], local_matrix[i][j] / 6.0);
+            }
+        });
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> mat20 = assembler.assemble();
+        chronometer.stop();
+
+        algebra::SparseMatrix<double, StorageOrder::RowMajor> mat21(n, n);
+        for (std::size_t e = 0; e < m * m; ++e) {
+            const auto nodes = element_nodes(e);
+            for (std::size_t i = 0; i < 4; ++i)
+                for (std::size_t j = 0; j < 4; ++j)
+                    mat21.add(nodes[i], nodes[j], local_matrix[i][j] / 6.0);
+        }
+        mat21.compress();
+        const std::vector<double> ones(n, 1.0);
+        double row_sum = 0, difference = 0;
+        const std::vector<double> y = mat20 * ones, z = mat21 * ones;
+        for (std::size_t i = 0; i < n; ++i) {
+            row_sum = std::max(row_sum, std::abs(y[i]));
+            difference = std::max(difference, std::abs(y[i] - z[i]));
+        }
+        std::cout << "Concurrent assembly: " << chronometer.wallTime() << " usec, non-zeros " << mat20.get_nnz() << " (serial "
+                  << mat21.get_nnz() << "), max row sum " << row_sum << ", max difference " << difference << std::endl;
+    }
+
     return 0;
 }
\ No newline at end of file